@@ -4,6 +4,10 @@
 #include <time.h>
 #include <sys/time.h>
 #include <Preferences.h>
+#include <stdarg.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 // Конфигурация пинов реле:
 // IN1 -> GPIO41 (Lighting), IN2 -> GPIO42 (Pump)
@@ -16,6 +20,19 @@ const bool relayActiveHigh = false;  // инвертировано
 // Скорость Serial для управления из монитора порта
 const unsigned long serialBaudRate = 115200;
 
+// Разделение по ядрам: реле и расписания — отдельная задача с высоким приоритетом,
+// Wi‑Fi, HTTP и Serial — на другом ядре (там же, где стек Wi‑Fi)
+#if CONFIG_FREERTOS_UNICORE
+const BaseType_t CONTROL_CORE = 0;
+#else
+const BaseType_t CONTROL_CORE = 1;
+#endif
+const BaseType_t NETWORK_CORE    = 0;
+const UBaseType_t CONTROL_PRIORITY = 10;
+const UBaseType_t NETWORK_PRIORITY = 1;
+const uint32_t CONTROL_TICK_MS = 20;   // период проверки расписаний
+const uint32_t APPLY_WAIT_MS   = 100;  // сколько HTTP-ответ ждёт применения команды
+
 // Настройки Wi‑Fi (замените на свои)
 const char* WIFI_SSID     = "Smart Home";
 const char* WIFI_PASSWORD = "qazwsxedc";
@@ -32,11 +49,14 @@ Preferences prefs;
 
 // HTTP сервер
 WebServer server(80);
-// Кольцевой буфер для последних N событий
-struct Event { unsigned long ts; String msg; };
+// Кольцевой буфер для последних N событий: компактные записи без String,
+// текст формируется только при чтении /api/events
+enum EventCode : uint8_t { EV_RELAY_OFF = 0, EV_RELAY_ON = 1 };
+struct Event { uint32_t ts; uint8_t code; uint8_t ch; };
 const size_t MAX_EVENTS = 50;
 Event events[MAX_EVENTS];
-size_t eventsHead = 0, eventsCount = 0;
+// Пишет только задача управления; число записанных событий публикуется после записи слота
+std::atomic<uint32_t> eventsTotal{0};
 
 // Параметры: помпа — циклический скедулер (в минутах)
 struct CycleCfg { bool enabled; uint16_t onMin; uint16_t offMin; unsigned long lastTickMs; bool currentlyOn; };
@@ -45,17 +65,89 @@ CycleCfg schedPump { false, 1, 14, 0, false };
 // Параметры: свет — расписание по времени суток (минуты с начала дня)
 struct ClockCfg { bool enabled; uint16_t onMins; uint16_t offMins; bool lastAppliedOn; };
 ClockCfg lightClock { false, 6*60, 22*60, false };
+// schedPump и lightClock после старта задач принадлежат задаче управления
+
+// Команды от HTTP/Serial к задаче управления
+enum CmdOp : uint8_t { OP_RELAY = 0, OP_SCHED_PUMP, OP_SCHED_LIGHT };
+// Маска полей для OP_SCHED_*
+const uint8_t F_EN = 1, F_ON = 2, F_OFF = 4;
+struct ControlCmd { uint32_t seq; uint8_t op; uint8_t ch; uint8_t mask; bool flag; uint16_t on; uint16_t off; };
+
+// Очередь SPSC без блокировок: кладёт только сетевая задача, забирает только задача управления
+class CommandQueue {
+ public:
+  static const uint32_t SIZE = 16;
+  bool push(const ControlCmd &c) {
+    const uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= SIZE) return false;
+    slots[h % SIZE] = c;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+  bool pop(ControlCmd &out) {
+    const uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    out = slots[t % SIZE];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+ private:
+  ControlCmd slots[SIZE];
+  std::atomic<uint32_t> head{0}, tail{0};
+};
+
+CommandQueue cmdQueue;
+TaskHandle_t controlTaskHandle = nullptr;
+uint32_t cmdSeq = 0;                      // только сетевая задача
+std::atomic<uint32_t> appliedSeq{0};      // последняя применённая команда
+std::atomic<bool> configDirty{false};     // настройки сохраняет сетевая задача
+
+// Снимок состояния для /api/status. Публикует задача управления (seqlock):
+// читатель не блокируется, а при совпадении с записью просто повторяет копирование
+struct StatusSnapshot {
+  bool lightOn, pumpOn;
+  bool pumpEn; uint16_t pumpOnMin, pumpOffMin;
+  bool lightEn; uint16_t lightOnMins, lightOffMins;
+};
+StatusSnapshot statusSnap;
+std::atomic<uint32_t> statusVer{0};
+
+void publishStatus() {
+  const int activeState = relayActiveHigh ? HIGH : LOW;
+  statusVer.fetch_add(1, std::memory_order_relaxed);  // нечётная — идёт запись
+  std::atomic_thread_fence(std::memory_order_release);
+  statusSnap.lightOn      = digitalRead(relayLightingPin) == activeState;
+  statusSnap.pumpOn       = digitalRead(relayPumpPin)     == activeState;
+  statusSnap.pumpEn       = schedPump.enabled;
+  statusSnap.pumpOnMin    = schedPump.onMin;
+  statusSnap.pumpOffMin   = schedPump.offMin;
+  statusSnap.lightEn      = lightClock.enabled;
+  statusSnap.lightOnMins  = lightClock.onMins;
+  statusSnap.lightOffMins = lightClock.offMins;
+  statusVer.fetch_add(1, std::memory_order_release);
+}
 
-void saveConfig() {
+StatusSnapshot readStatus() {
+  StatusSnapshot copy;
+  for (;;) {
+    const uint32_t v = statusVer.load(std::memory_order_acquire);
+    if (v & 1) continue;
+    copy = statusSnap;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (statusVer.load(std::memory_order_relaxed) == v) return copy;
+  }
+}
+
+void saveConfig(const StatusSnapshot &st) {
   if (!prefs.begin("hydro", false)) return;
   prefs.putBool ("ntp", ntpEnabled);
   prefs.putLong ("tz",  gmtOffsetSec);
-  prefs.putBool ("p_en", schedPump.enabled);
-  prefs.putUShort("p_on", schedPump.onMin);
-  prefs.putUShort("p_off",schedPump.offMin);
-  prefs.putBool ("l_en", lightClock.enabled);
-  prefs.putUShort("l_on", lightClock.onMins);
-  prefs.putUShort("l_off",lightClock.offMins);
+  prefs.putBool ("p_en", st.pumpEn);
+  prefs.putUShort("p_on", st.pumpOnMin);
+  prefs.putUShort("p_off",st.pumpOffMin);
+  prefs.putBool ("l_en", st.lightEn);
+  prefs.putUShort("l_on", st.lightOnMins);
+  prefs.putUShort("l_off",st.lightOffMins);
   prefs.end();
 }
 
@@ -72,18 +164,22 @@ void loadConfig() {
   prefs.end();
 }
 
-void pushEvent(const String &m) {
-  events[eventsHead] = { millis(), m };
-  eventsHead = (eventsHead + 1) % MAX_EVENTS;
-  if (eventsCount < MAX_EVENTS) eventsCount++;
+void pushEvent(uint8_t code, uint8_t ch) {
+  const uint32_t n = eventsTotal.load(std::memory_order_relaxed);
+  events[n % MAX_EVENTS] = { (uint32_t)millis(), code, ch };
+  eventsTotal.store(n + 1, std::memory_order_release);
 }
 
+// Номер канала как в /api/relay: 1 — освещение, 2 — помпа
+uint8_t relayChannel(int pinNumber) { return pinNumber == relayLightingPin ? 1 : 2; }
+
+const char* channelName(uint8_t ch) { return ch == 1 ? "Lighting" : "Water pump"; }
+
 void setRelayState(int pinNumber, bool shouldTurnOn) {
   const int activeState   = relayActiveHigh ? HIGH : LOW;
   const int inactiveState = relayActiveHigh ? LOW  : HIGH;
   digitalWrite(pinNumber, shouldTurnOn ? activeState : inactiveState);
-  String name = (pinNumber == relayLightingPin) ? F("Lighting") : F("Water pump");
-  pushEvent(name + (shouldTurnOn ? F(" -> ON") : F(" -> OFF")));
+  pushEvent(shouldTurnOn ? EV_RELAY_ON : EV_RELAY_OFF, relayChannel(pinNumber));
 }
 
 void applyPumpCycle(CycleCfg &cfg, int pin) {
@@ -103,9 +199,8 @@ void applyPumpCycle(CycleCfg &cfg, int pin) {
 bool getLocalTM(struct tm &out) {
   time_t now; time(&now);
   if (now < 100000) return false; // время не синхронизировано
-  struct tm *lt = localtime(&now);
-  if (!lt) return false;
-  out = *lt; return true;
+  // localtime_r: вызывается из обеих задач
+  return localtime_r(&now, &out) != nullptr;
 }
 
 uint16_t hhmmToMins(const String &s) {
@@ -117,10 +212,9 @@ uint16_t hhmmToMins(const String &s) {
   return (uint16_t)(hh*60+mm);
 }
 
-String minsToHHMM(uint16_t m) {
+void minsToHHMM(uint16_t m, char (&buf)[6]) {
   uint16_t hh = (m/60)%24; uint16_t mm = m%60;
-  char buf[6]; snprintf(buf,sizeof(buf), "%02u:%02u", (unsigned)hh,(unsigned)mm);
-  return String(buf);
+  snprintf(buf,sizeof(buf), "%02u:%02u", (unsigned)hh,(unsigned)mm);
 }
 
 void applyLightByClock() {
@@ -166,31 +260,76 @@ void printStatus() {
   Serial.println();
 }
 
-String jsonStatus() {
-  const int activeState = relayActiveHigh ? HIGH : LOW;
-  bool lightOn = (digitalRead(relayLightingPin) == activeState);
-  bool pumpOn  = (digitalRead(relayPumpPin)     == activeState);
+// Потоковый JSON-ответ: фиксированный буфер на стеке уходит клиенту чанками
+// через sendContent, без String и без сборки всего ответа в памяти
+class JsonStream {
+ public:
+  void begin(int code) {
+    len = 0;
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(code, "application/json", "");
+  }
+  void write(const char *s, size_t n) {
+    while (n > 0) {
+      size_t k = sizeof(buf) - len; if (k > n) k = n;
+      memcpy(buf + len, s, k); len += k; s += k; n -= k;
+      if (len == sizeof(buf)) flush();
+    }
+  }
+  void print(const char *s) { write(s, strlen(s)); }
+  void printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char tmp[96];
+    va_list args; va_start(args, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, args);
+    va_end(args);
+    if (n > 0) write(tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+  }
+  void end() { flush(); server.sendContent("", 0); }
+ private:
+  void flush() { if (len) { server.sendContent(buf, len); len = 0; } }
+  char buf[256];
+  size_t len = 0;
+};
+
+void sendNoCacheHeaders() {
+  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+  server.sendHeader("Pragma", "no-cache");
+  server.sendHeader("Expires", "0");
+}
+
+void sendStatus() {
+  const StatusSnapshot st = readStatus();
   struct tm lt; bool tv = getLocalTM(lt);
   char tbuf[20]=""; if (tv) snprintf(tbuf,sizeof(tbuf), "%04d-%02d-%02d %02d:%02d:%02d",
     lt.tm_year+1900, lt.tm_mon+1, lt.tm_mday, lt.tm_hour, lt.tm_min, lt.tm_sec);
-  String json = "{";
-  json += "\"lighting\":"; json += lightOn?"true":"false";
-  json += ",\"pump\":";     json += pumpOn?"true":"false";
-  json += ",\"time\":\"";   json += String(tbuf); json += "\"";
-  json += ",\"ntp\":";      json += ntpEnabled?"true":"false";
-  json += ",\"tz\":";       json += gmtOffsetSec;
-  json += ",\"sched\":{\"lightClock\":{\"en\":"; json += lightClock.enabled?"true":"false";
-  json += ",\"on\":\""; json += minsToHHMM(lightClock.onMins); json += "\"";
-  json += ",\"off\":\""; json += minsToHHMM(lightClock.offMins); json += "\"";
-  json += "},\"pump\":{\"en\":"; json += schedPump.enabled?"true":"false"; json += ",\"on\":"; json += schedPump.onMin; json += ",\"off\":"; json += schedPump.offMin; json += "}}}";
-  return json;
+  char onBuf[6], offBuf[6];
+  minsToHHMM(st.lightOnMins, onBuf); minsToHHMM(st.lightOffMins, offBuf);
+  sendNoCacheHeaders();
+  JsonStream out; out.begin(200);
+  out.printf("{\"lighting\":%s,\"pump\":%s,\"time\":\"%s\",\"ntp\":%s,\"tz\":%ld",
+    st.lightOn?"true":"false", st.pumpOn?"true":"false", tbuf, ntpEnabled?"true":"false", gmtOffsetSec);
+  out.printf(",\"sched\":{\"lightClock\":{\"en\":%s,\"on\":\"%s\",\"off\":\"%s\"}",
+    st.lightEn?"true":"false", onBuf, offBuf);
+  out.printf(",\"pump\":{\"en\":%s,\"on\":%u,\"off\":%u}}}",
+    st.pumpEn?"true":"false", (unsigned)st.pumpOnMin, (unsigned)st.pumpOffMin);
+  out.end();
 }
 
-void handleStatus() {
-  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "0");
-  server.send(200, "application/json", jsonStatus());
+void handleStatus() { sendStatus(); }
+
+// Ставит команду в очередь задачи управления и ждёт (ограниченно) её применения,
+// чтобы ответ уже содержал новое состояние. false — очередь полна, ответ 503 отправлен
+bool submitCommand(ControlCmd c) {
+  c.seq = ++cmdSeq;
+  if (!cmdQueue.push(c)) {
+    server.send(503, "application/json", "{\"error\":\"busy\"}");
+    return false;
+  }
+  xTaskNotifyGive(controlTaskHandle);
+  const uint32_t start = millis();
+  while ((int32_t)(appliedSeq.load(std::memory_order_acquire) - c.seq) < 0 && millis() - start < APPLY_WAIT_MS)
+    vTaskDelay(1);
+  return true;
 }
 
 void handleRelayApi() {
@@ -201,55 +340,48 @@ void handleRelayApi() {
   }
   int ch = server.arg("ch").toInt();
   bool on = (server.arg("on") == "1" || server.arg("on") == "true");
-  if (ch == 1)      { setRelayState(relayLightingPin, on); lightClock.lastAppliedOn = on; }
-  else if (ch == 2) { setRelayState(relayPumpPin, on);     schedPump.currentlyOn  = on; schedPump.lastTickMs  = millis(); }
-  else { server.send(400, "application/json", "{\"error\":\"ch must be 1 or 2\"}"); return; }
-  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "0");
-  server.send(200, "application/json", jsonStatus());
+  if (ch != 1 && ch != 2) { server.send(400, "application/json", "{\"error\":\"ch must be 1 or 2\"}"); return; }
+  ControlCmd c{}; c.op = OP_RELAY; c.ch = (uint8_t)ch; c.flag = on;
+  if (submitCommand(c)) sendStatus();
 }
 
 void handleEvents() {
-  String json = "[";
-  for (size_t i = 0; i < eventsCount; i++) {
-    size_t idx = (eventsHead + MAX_EVENTS - eventsCount + i) % MAX_EVENTS;
-    if (i) json += ',';
-    json += '{';
-    json += "\"ts\":"; json += events[idx].ts; json += ',';
-    json += "\"msg\":\""; json += events[idx].msg; json += "\"";
-    json += '}';
+  // Копия кольца на стеке; записи, перезаписанные во время копирования, отбрасываются
+  Event copy[MAX_EVENTS];
+  const uint32_t total = eventsTotal.load(std::memory_order_acquire);
+  memcpy(copy, events, sizeof(copy));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint32_t after = eventsTotal.load(std::memory_order_relaxed);
+  uint32_t first = total > MAX_EVENTS ? total - MAX_EVENTS : 0;
+  if (after + 1 > MAX_EVENTS && first < after + 1 - MAX_EVENTS) first = after + 1 - MAX_EVENTS;
+  sendNoCacheHeaders();
+  JsonStream out; out.begin(200);
+  out.print("[");
+  for (uint32_t n = first; n < total; n++) {
+    const Event &e = copy[n % MAX_EVENTS];
+    out.printf("%s{\"ts\":%lu,\"msg\":\"%s -> %s\"}", n != first ? "," : "", (unsigned long)e.ts,
+      channelName(e.ch), e.code == EV_RELAY_ON ? "ON" : "OFF");
   }
-  json += "]";
-  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "0");
-  server.send(200, "application/json", json);
+  out.print("]");
+  out.end();
 }
 
 void handleSchedulePump() {
   // /api/schedule_pump?en=1&on=1&off=14  (минуты)
-  if (server.hasArg("en"))  schedPump.enabled = (server.arg("en")=="1" || server.arg("en")=="true");
-  if (server.hasArg("on"))  schedPump.onMin   = (uint16_t) server.arg("on").toInt();
-  if (server.hasArg("off")) schedPump.offMin  = (uint16_t) server.arg("off").toInt();
-  schedPump.lastTickMs = millis();
-  saveConfig();
-  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "0");
-  server.send(200, "application/json", jsonStatus());
+  ControlCmd c{}; c.op = OP_SCHED_PUMP;
+  if (server.hasArg("en"))  { c.mask |= F_EN;  c.flag = (server.arg("en")=="1" || server.arg("en")=="true"); }
+  if (server.hasArg("on"))  { c.mask |= F_ON;  c.on   = (uint16_t) server.arg("on").toInt(); }
+  if (server.hasArg("off")) { c.mask |= F_OFF; c.off  = (uint16_t) server.arg("off").toInt(); }
+  if (submitCommand(c)) sendStatus();
 }
 
 void handleScheduleLight() {
   // /api/schedule_light?en=1&on=HH:MM&off=HH:MM
-  if (server.hasArg("en"))  lightClock.enabled = (server.arg("en")=="1" || server.arg("en")=="true");
-  if (server.hasArg("on"))  lightClock.onMins  = hhmmToMins(server.arg("on"));
-  if (server.hasArg("off")) lightClock.offMins = hhmmToMins(server.arg("off"));
-  saveConfig();
-  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "0");
-  server.send(200, "application/json", jsonStatus());
+  ControlCmd c{}; c.op = OP_SCHED_LIGHT;
+  if (server.hasArg("en"))  { c.mask |= F_EN;  c.flag = (server.arg("en")=="1" || server.arg("en")=="true"); }
+  if (server.hasArg("on"))  { c.mask |= F_ON;  c.on   = hhmmToMins(server.arg("on")); }
+  if (server.hasArg("off")) { c.mask |= F_OFF; c.off  = hhmmToMins(server.arg("off")); }
+  if (submitCommand(c)) sendStatus();
 }
 
 void handleTimeConfig() {
@@ -261,11 +393,8 @@ void handleTimeConfig() {
     struct timeval tv{ .tv_sec = e, .tv_usec = 0 }; settimeofday(&tv, nullptr);
   }
   if (ntpEnabled && WiFi.status()==WL_CONNECTED) { configTime(gmtOffsetSec, 0, NTP1, NTP2); }
-  saveConfig();
-  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "0");
-  server.send(200, "application/json", jsonStatus());
+  configDirty = true;
+  sendStatus();
 }
 
 const char INDEX_HTML[] PROGMEM = R"HTML(
@@ -447,21 +576,72 @@ void handleCommand(const String &raw) {
   if (cmd == "status") { printStatus(); return; }
 }
 
+// true — изменились сохраняемые настройки
+bool applyCommand(const ControlCmd &c) {
+  switch (c.op) {
+    case OP_RELAY:
+      if (c.ch == 1) { setRelayState(relayLightingPin, c.flag); lightClock.lastAppliedOn = c.flag; }
+      else           { setRelayState(relayPumpPin, c.flag);     schedPump.currentlyOn  = c.flag; schedPump.lastTickMs = millis(); }
+      return false;
+    case OP_SCHED_PUMP:
+      if (c.mask & F_EN)  schedPump.enabled = c.flag;
+      if (c.mask & F_ON)  schedPump.onMin   = c.on;
+      if (c.mask & F_OFF) schedPump.offMin  = c.off;
+      schedPump.lastTickMs = millis();
+      return true;
+    case OP_SCHED_LIGHT:
+      if (c.mask & F_EN)  lightClock.enabled = c.flag;
+      if (c.mask & F_ON)  lightClock.onMins  = c.on;
+      if (c.mask & F_OFF) lightClock.offMins = c.off;
+      return true;
+  }
+  return false;
+}
+
+// Задача управления: команды из очереди, расписания, публикация снимка.
+// Просыпается по уведомлению от сетевой задачи или раз в CONTROL_TICK_MS
+void controlTask(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONTROL_TICK_MS));
+    ControlCmd c; uint32_t last = 0; bool any = false, changed = false;
+    while (cmdQueue.pop(c)) { changed |= applyCommand(c); last = c.seq; any = true; }
+    applyLightByClock();
+    applyPumpCycle(schedPump, relayPumpPin);
+    publishStatus();
+    // Флаг — после публикации: сетевая задача сохраняет настройки из снимка
+    if (changed) configDirty = true;
+    if (any) appliedSeq.store(last, std::memory_order_release);
+  }
+}
+
+// Сетевая задача: Wi‑Fi (в том числе блокирующее подключение), HTTP, NTP, Serial и запись настроек
+void networkTask(void *) {
+  connectWiFi(); ensureTimeSync();
+  server.stop(); setupWebServer();
+  for (;;) {
+    ensureTimeSync();
+    server.handleClient();
+    String line = readLineFromSerial();
+    if (line.length() > 0) handleCommand(line);
+    if (configDirty.exchange(false)) saveConfig(readStatus());
+    vTaskDelay(1);
+  }
+}
+
 void setup() {
   Serial.begin(serialBaudRate); delay(200);
   loadConfig();
   pinMode(relayLightingPin, OUTPUT); pinMode(relayPumpPin, OUTPUT);
   setRelayState(relayLightingPin, false); setRelayState(relayPumpPin, false);
+  publishStatus();
   Serial.println(F("Hydroponics Relay Controller (ESP32-S3)"));
-  connectWiFi(); ensureTimeSync();
-  server.stop(); setupWebServer();
+  xTaskCreatePinnedToCore(controlTask, "relay_ctl", 4096, nullptr, CONTROL_PRIORITY, &controlTaskHandle, CONTROL_CORE);
+  xTaskCreatePinnedToCore(networkTask, "relay_net", 8192, nullptr, NETWORK_PRIORITY, nullptr, NETWORK_CORE);
 }
 
 void loop() {
-  ensureTimeSync();
-  applyLightByClock();
-  applyPumpCycle(schedPump,  relayPumpPin);
-  server.handleClient();
+  // Вся работа — в задачах controlTask и networkTask
+  vTaskDelete(nullptr);
 }
 
 
@@ -1,11 +1,29 @@
+import logging
+
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import web_server, fan, light, time
-from esphome.const import CONF_ID
+from esphome import pins
+from esphome.components import web_server, fan, light, sensor, time
+from esphome.components.esp32 import add_idf_sdkconfig_option
+from esphome.const import (
+    CONF_ID,
+    CONF_PORT,
+    CONF_UPDATE_INTERVAL,
+    DEVICE_CLASS_PH,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_PH,
+)
+from esphome.core import CORE
+
+from .index_html import compress_index_html, render_index_html
 
-AUTO_LOAD = ["web_server", "fan", "light", "time"]
+# web_server не подгружается автоматически: он нужен только при rest_api/web_ui и
+# тогда уже объявлен в конфигурации (web_server_id)
+AUTO_LOAD = ["fan", "light", "sensor", "time"]
 CODEOWNERS = ["@hydroponic"]
 
+_LOGGER = logging.getLogger(__name__)
+
 CONF_PUMP_ID = "pump_id"
 CONF_LIGHT_ID = "light_id"
 CONF_TIME_ID = "time_id"
@@ -13,34 +31,231 @@ CONF_WEB_SERVER_ID = "web_server_id"
 CONF_ON_MINUTES = "on_minutes"
 CONF_OFF_MINUTES = "off_minutes"
 CONF_ENABLED = "enabled"
+CONF_MAX_STREAM_CLIENTS = "max_stream_clients"
+CONF_SAVE_DELAY = "save_delay"
+CONF_HISTORY_SIZE = "history_size"
+CONF_HISTORY_INTERVAL = "history_interval"
+CONF_HISTORY_SENSORS = "history_sensors"
+CONF_ANALOG = "analog"
+CONF_PH = "ph"
+CONF_EC = "ec"
+CONF_PH_PIN = "ph_pin"
+CONF_EC_PIN = "ec_pin"
+CONF_TEMPERATURE_ID = "temperature_id"
+CONF_PH_NEUTRAL_MV = "ph_neutral_mv"
+CONF_PH_ACID_MV = "ph_acid_mv"
+CONF_EC_K_VALUE = "ec_k_value"
+CONF_POWER_SAVE = "power_save"
+CONF_MAX_SLEEP = "max_sleep"
+CONF_WAKE_GUARD = "wake_guard"
+CONF_AWAKE_AFTER_ACTIVITY = "awake_after_activity"
+CONF_HOLD_PINS = "hold_pins"
+CONF_PUMP_SCHEDULE = "pump_schedule"
+CONF_LIGHT_SCHEDULE = "light_schedule"
+CONF_REST_API = "rest_api"
+CONF_WEB_UI = "web_ui"
+CONF_OTA_UI = "ota_ui"
+CONF_WEBSOCKET = "websocket"
+CONF_MAX_CLIENTS = "max_clients"
+
+# Флаги состава прошивки -> define для hydroponic_controller.h
+FEATURE_DEFINES = {
+    CONF_PUMP_SCHEDULE: "USE_HYDRO_PUMP_SCHEDULE",
+    CONF_LIGHT_SCHEDULE: "USE_HYDRO_LIGHT_SCHEDULE",
+    CONF_REST_API: "USE_HYDRO_REST_API",
+    CONF_WEB_UI: "USE_HYDRO_WEB_UI",
+}
 
 hydroponic_controller_ns = cg.esphome_ns.namespace("hydroponic_controller")
 HydroponicController = hydroponic_controller_ns.class_("HydroponicController", cg.Component)
 
-CONFIG_SCHEMA = cv.Schema({
+# Как MAX_CHANNELS в channels.h
+MAX_CHANNELS = 4
+
+
+def add_index_html(config):
+    raw = render_index_html(config).encode("utf-8")
+    data, etag = compress_index_html(raw)
+    _LOGGER.info("hydroponic_controller: web UI %d bytes (%d before gzip)", len(data), len(raw))
+    cg.add_global(cg.RawExpression(
+        f"const uint8_t HYDROPONIC_INDEX_HTML[{len(data)}] PROGMEM = {{{', '.join(str(b) for b in data)}}}"))
+    cg.add_global(cg.RawExpression(f"const size_t HYDROPONIC_INDEX_HTML_SIZE = {len(data)}"))
+    cg.add_global(cg.RawExpression(f'const char HYDROPONIC_INDEX_ETAG[] = "\\"{etag}\\""'))
+
+
+# pH/EC через ADC continuous; пины — только ADC1
+ANALOG_SCHEMA = cv.Schema({
+    cv.Optional(CONF_PH_PIN, default=35): pins.internal_gpio_input_pin_number,
+    cv.Optional(CONF_EC_PIN, default=34): pins.internal_gpio_input_pin_number,
+    cv.Optional(CONF_TEMPERATURE_ID): cv.use_id(sensor.Sensor),
+    cv.Optional(CONF_UPDATE_INTERVAL, default="10s"): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(min=cv.TimePeriod(seconds=1)),
+    ),
+    cv.Optional(CONF_PH_NEUTRAL_MV, default=1500): cv.int_range(min=0, max=3300),
+    cv.Optional(CONF_PH_ACID_MV, default=2032): cv.int_range(min=0, max=3300),
+    cv.Optional(CONF_EC_K_VALUE, default=1.0): cv.float_range(min=0.1, max=10.0),
+    cv.Optional(CONF_PH): sensor.sensor_schema(
+        unit_of_measurement=UNIT_PH,
+        accuracy_decimals=2,
+        device_class=DEVICE_CLASS_PH,
+        state_class=STATE_CLASS_MEASUREMENT,
+    ),
+    cv.Optional(CONF_EC): sensor.sensor_schema(
+        unit_of_measurement="mS/cm",
+        icon="mdi:water-opacity",
+        accuracy_decimals=2,
+        state_class=STATE_CLASS_MEASUREMENT,
+    ),
+})
+
+# Light sleep между дедлайнами; hold_pins — пины PWM-выходов помпы и света
+POWER_SAVE_SCHEMA = cv.Schema({
+    cv.Optional(CONF_MAX_SLEEP, default="500ms"): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(min=cv.TimePeriod(milliseconds=50), max=cv.TimePeriod(seconds=10)),
+    ),
+    cv.Optional(CONF_WAKE_GUARD, default="10ms"): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(max=cv.TimePeriod(seconds=1)),
+    ),
+    cv.Optional(CONF_AWAKE_AFTER_ACTIVITY, default="30s"): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_HOLD_PINS, default=[]): cv.All(
+        cv.ensure_list(pins.internal_gpio_output_pin_number),
+        cv.Length(max=4),
+    ),
+})
+
+# Двоичный протокол на отдельном httpd; порт не должен совпадать с web_server
+WEBSOCKET_SCHEMA = cv.Schema({
+    cv.Optional(CONF_PORT, default=81): cv.port,
+    cv.Optional(CONF_MAX_CLIENTS, default=3): cv.int_range(min=1, max=4),
+})
+
+def validate_features(config):
+    if config[CONF_WEB_UI] and not config[CONF_REST_API]:
+        raise cv.Invalid(f"{CONF_WEB_UI} requires {CONF_REST_API}")
+    if config[CONF_OTA_UI] and not config[CONF_WEB_UI]:
+        raise cv.Invalid(f"{CONF_OTA_UI} requires {CONF_WEB_UI}")
+    if config[CONF_LIGHT_SCHEDULE] and CONF_TIME_ID not in config:
+        raise cv.Invalid(f"{CONF_TIME_ID} is required when {CONF_LIGHT_SCHEDULE} is enabled")
+    if config[CONF_REST_API] and CONF_WEB_SERVER_ID not in config:
+        raise cv.Invalid(f"{CONF_WEB_SERVER_ID} is required when {CONF_REST_API} is enabled")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(cv.Schema({
     cv.GenerateID(): cv.declare_id(HydroponicController),
-    cv.Required(CONF_PUMP_ID): cv.use_id(fan.Fan),
-    cv.Required(CONF_LIGHT_ID): cv.use_id(light.LightState),
-    cv.Required(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
-    cv.Required(CONF_WEB_SERVER_ID): cv.use_id(web_server.WebServer),
+    # Один ID или список: каждый элемент — отдельный канал, номер канала — позиция в списке
+    cv.Required(CONF_PUMP_ID): cv.All(
+        cv.ensure_list(cv.use_id(fan.Fan)),
+        cv.Length(min=1, max=MAX_CHANNELS),
+    ),
+    cv.Required(CONF_LIGHT_ID): cv.All(
+        cv.ensure_list(cv.use_id(light.LightState)),
+        cv.Length(min=1, max=MAX_CHANNELS),
+    ),
+    cv.Optional(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+    cv.Optional(CONF_WEB_SERVER_ID): cv.use_id(web_server.WebServer),
+    # Состав прошивки: выключенное не компилируется
+    cv.Optional(CONF_PUMP_SCHEDULE, default=True): cv.boolean,
+    cv.Optional(CONF_LIGHT_SCHEDULE, default=True): cv.boolean,
+    cv.Optional(CONF_REST_API, default=True): cv.boolean,
+    cv.Optional(CONF_WEB_UI, default=True): cv.boolean,
+    cv.Optional(CONF_OTA_UI, default=True): cv.boolean,
     cv.Optional(CONF_ON_MINUTES, default=5): cv.int_range(min=1, max=120),
     cv.Optional(CONF_OFF_MINUTES, default=15): cv.int_range(min=1, max=120),
     cv.Optional(CONF_ENABLED, default=False): cv.boolean,
-}).extend(cv.COMPONENT_SCHEMA)
+    cv.Optional(CONF_MAX_STREAM_CLIENTS, default=4): cv.int_range(min=1, max=8),
+    cv.Optional(CONF_SAVE_DELAY, default="5s"): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(max=cv.TimePeriod(seconds=60)),
+    ),
+    # 0 — история выключена; блоки по 256 байт, нужно больше 8 блоков
+    cv.Optional(CONF_HISTORY_SIZE, default=0): cv.Any(
+        cv.one_of(0, int=True),
+        cv.int_range(min=4096, max=262144),
+    ),
+    cv.Optional(CONF_HISTORY_INTERVAL, default="5min"): cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(min=cv.TimePeriod(seconds=10)),
+    ),
+    cv.Optional(CONF_HISTORY_SENSORS, default=[]): cv.All(
+        cv.ensure_list(cv.use_id(sensor.Sensor)),
+        cv.Length(max=6),
+    ),
+    cv.Optional(CONF_ANALOG): ANALOG_SCHEMA,
+    cv.Optional(CONF_POWER_SAVE): POWER_SAVE_SCHEMA,
+    cv.Optional(CONF_WEBSOCKET): WEBSOCKET_SCHEMA,
+}).extend(cv.COMPONENT_SCHEMA), validate_features)
 
 
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
 
-    pump = await cg.get_variable(config[CONF_PUMP_ID])
-    light_ = await cg.get_variable(config[CONF_LIGHT_ID])
-    time_ = await cg.get_variable(config[CONF_TIME_ID])
-    server = await cg.get_variable(config[CONF_WEB_SERVER_ID])
+    for key, define in FEATURE_DEFINES.items():
+        if config[key]:
+            cg.add_define(define)
 
-    cg.add(var.set_pump(pump))
-    cg.add(var.set_light(light_))
-    cg.add(var.set_clock(time_))
-    cg.add(var.set_server(server))
+    for pump_id in config[CONF_PUMP_ID]:
+        pump = await cg.get_variable(pump_id)
+        cg.add(var.add_pump(pump))
+    for light_id in config[CONF_LIGHT_ID]:
+        light_ = await cg.get_variable(light_id)
+        cg.add(var.add_light(light_))
+    # Часы нужны расписанию света и меткам времени истории
+    if CONF_TIME_ID in config:
+        time_ = await cg.get_variable(config[CONF_TIME_ID])
+        cg.add(var.set_clock(time_))
+    if config[CONF_REST_API]:
+        server = await cg.get_variable(config[CONF_WEB_SERVER_ID])
+        cg.add(var.set_server(server))
+        cg.add(var.set_max_stream_clients(config[CONF_MAX_STREAM_CLIENTS]))
     cg.add(var.set_durations(config[CONF_ON_MINUTES], config[CONF_OFF_MINUTES]))
     cg.add(var.set_enabled(config[CONF_ENABLED]))
+    cg.add(var.set_save_delay(config[CONF_SAVE_DELAY]))
+    cg.add(var.set_history_size(config[CONF_HISTORY_SIZE]))
+    cg.add(var.set_history_interval(config[CONF_HISTORY_INTERVAL]))
+    for sensor_id in config[CONF_HISTORY_SENSORS]:
+        sens = await cg.get_variable(sensor_id)
+        cg.add(var.add_history_sensor(sens))
+
+    if CONF_ANALOG in config:
+        conf = config[CONF_ANALOG]
+        cg.add_define("USE_HYDRO_ANALOG")
+        cg.add(var.set_analog_pins(conf[CONF_PH_PIN], conf[CONF_EC_PIN]))
+        cg.add(var.set_analog_interval(conf[CONF_UPDATE_INTERVAL]))
+        cg.add(var.set_ph_calibration(conf[CONF_PH_NEUTRAL_MV], conf[CONF_PH_ACID_MV]))
+        cg.add(var.set_ec_k_value(conf[CONF_EC_K_VALUE]))
+        if CONF_TEMPERATURE_ID in conf:
+            temp = await cg.get_variable(conf[CONF_TEMPERATURE_ID])
+            cg.add(var.set_water_temperature(temp))
+        if CONF_PH in conf:
+            sens = await sensor.new_sensor(conf[CONF_PH])
+            cg.add(var.set_ph_sensor(sens))
+        if CONF_EC in conf:
+            sens = await sensor.new_sensor(conf[CONF_EC])
+            cg.add(var.set_ec_sensor(sens))
+
+    if CONF_POWER_SAVE in config:
+        conf = config[CONF_POWER_SAVE]
+        cg.add_define("USE_HYDRO_POWER_SAVE")
+        power = var.get_power_save()
+        cg.add(power.set_max_sleep(conf[CONF_MAX_SLEEP]))
+        cg.add(power.set_guard(conf[CONF_WAKE_GUARD]))
+        cg.add(power.set_awake_after_activity(conf[CONF_AWAKE_AFTER_ACTIVITY]))
+        for pin in conf[CONF_HOLD_PINS]:
+            cg.add(power.add_hold_pin(pin))
+
+    if CONF_WEBSOCKET in config:
+        conf = config[CONF_WEBSOCKET]
+        cg.add_define("USE_HYDRO_WS")
+        cg.add(var.set_ws_port(conf[CONF_PORT]))
+        cg.add(var.set_max_ws_clients(conf[CONF_MAX_CLIENTS]))
+        # В сборке Arduino поддержка WebSocket в httpd уже включена
+        if CORE.using_esp_idf:
+            add_idf_sdkconfig_option("CONFIG_HTTPD_WS_SUPPORT", True)
+
+    if config[CONF_WEB_UI]:
+        add_index_html(config)
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef USE_HYDRO_ANALOG
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_cali_scheme.h>
+#include <esp_adc/adc_continuous.h>
+#endif
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Фильтр канала: медиана последних MEDIAN_TAPS средних по кадру, затем EMA в Q16.
+// Медиана отбрасывает одиночные выбросы, EMA сглаживает шум; всё в целых.
+struct ChannelFilter {
+  static const uint8_t MEDIAN_TAPS = 7;
+  static const uint8_t EMA_SHIFT = 3;  // alpha = 1/8 на кадр
+
+  uint16_t window[MEDIAN_TAPS]{};
+  uint8_t size{0};
+  uint8_t pos{0};
+  int32_t ema_q16{0};
+
+  void push(uint16_t raw) {
+    window[pos] = raw;
+    pos = (pos + 1) % MEDIAN_TAPS;
+    if (size < MEDIAN_TAPS) size++;
+    uint16_t sorted[MEDIAN_TAPS];
+    for (uint8_t i = 0; i < size; i++) {
+      uint8_t j = i;
+      for (; j > 0 && sorted[j - 1] > window[i]; j--) sorted[j] = sorted[j - 1];
+      sorted[j] = window[i];
+    }
+    const int32_t median_q16 = (int32_t) sorted[size / 2] << 16;
+    if (size == 1) ema_q16 = median_q16;
+    else ema_q16 += (median_q16 - ema_q16) >> EMA_SHIFT;
+  }
+
+  bool ready() const { return size > 0; }
+  uint16_t value() const { return (uint16_t) ((ema_q16 + 0x8000) >> 16); }
+};
+
+// Пересчёты ниже в целых: мВ, милли-pH, милли-°C, мкСм/см.
+
+// pH по двум точкам калибровки DFRobot (мВ при pH 7.0 и при pH 4.0), калибровка при 25 °C;
+// крутизна электрода пропорциональна абсолютной температуре (Нернст)
+inline int32_t ph_milli(int32_t mv, int32_t neutral_mv, int32_t acid_mv, int32_t temp_mc) {
+  if (acid_mv == neutral_mv) return 7000;
+  const int64_t ph25 = (int64_t) (mv - neutral_mv) * -3000 / (acid_mv - neutral_mv);
+  return 7000 + (int32_t) (ph25 * 298150 / (temp_mc + 273150));
+}
+
+// EC DFRobot V2: 1000 * V / 820 / 200 мСм/см при K = 1, приведённая к 25 °C (1.85 %/°C)
+inline int32_t ec_us_cm(int32_t mv, int32_t k_milli, int32_t temp_mc) {
+  const int64_t ec = (int64_t) mv * k_milli / 164;
+  const int64_t denom = 1000000 + (int64_t) (temp_mc - 25000) * 37 / 2;
+  return denom > 0 ? (int32_t) (ec * 1000000 / denom) : 0;
+}
+
+#ifdef USE_HYDRO_ANALOG
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define HYDRO_ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define HYDRO_ADC_GET_CHANNEL(p) ((p)->type1.channel)
+#define HYDRO_ADC_GET_DATA(p) ((p)->type1.data)
+#else
+#define HYDRO_ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define HYDRO_ADC_GET_CHANNEL(p) ((p)->type2.channel)
+#define HYDRO_ADC_GET_DATA(p) ((p)->type2.data)
+#endif
+
+enum AnalogChannel : uint8_t {
+  ANALOG_PH = 0,
+  ANALOG_EC = 1,
+  ANALOG_CHANNELS = 2,
+};
+
+// Непрерывная оцифровка каналов ADC1 через DMA (adc_continuous).
+// Пул драйвера рассчитан ровно на два кадра: DMA заполняет один, пока loop() забирает
+// другой вызовом с нулевым таймаутом, поэтому loop() никогда не ждёт АЦП. Кадр
+// усредняется по каждому каналу (оверсэмплинг) и уходит в ChannelFilter.
+class AnalogSampler {
+ public:
+  static const uint16_t FRAME_BYTES = 256;
+
+  bool begin(const int (&gpio)[ANALOG_CHANNELS]) {
+    adc_continuous_handle_cfg_t cfg{};
+    cfg.max_store_buf_size = 2 * FRAME_BYTES;
+    cfg.conv_frame_size = FRAME_BYTES;
+    if (adc_continuous_new_handle(&cfg, &handle_) != ESP_OK) {
+      handle_ = nullptr;
+      return false;
+    }
+    adc_digi_pattern_config_t pattern[ANALOG_CHANNELS]{};
+    for (uint8_t i = 0; i < ANALOG_CHANNELS; i++) {
+      adc_unit_t unit;
+      adc_channel_t channel;
+      // В непрерывном режиме вместе с Wi-Fi доступен только ADC1
+      if (adc_continuous_io_to_channel(gpio[i], &unit, &channel) != ESP_OK || unit != ADC_UNIT_1) return fail_();
+      pattern[i].atten = ADC_ATTEN_DB_12;
+      pattern[i].channel = channel;
+      pattern[i].unit = unit;
+      pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+      channel_[i] = channel;
+    }
+    adc_continuous_config_t dig{};
+    dig.pattern_num = ANALOG_CHANNELS;
+    dig.adc_pattern = pattern;
+    dig.sample_freq_hz = SOC_ADC_SAMPLE_FREQ_THRES_LOW;
+    dig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    dig.format = HYDRO_ADC_OUTPUT_TYPE;
+    if (adc_continuous_config(handle_, &dig) != ESP_OK) return fail_();
+    init_calibration_();
+    if (adc_continuous_start(handle_) != ESP_OK) return fail_();
+    return true;
+  }
+
+  bool running() const { return handle_ != nullptr; }
+
+  // Забирает готовый кадр, если он есть; не блокирует
+  void poll() {
+    if (handle_ == nullptr) return;
+    uint8_t buf[FRAME_BYTES];
+    uint32_t len = 0;
+    if (adc_continuous_read(handle_, buf, FRAME_BYTES, &len, 0) != ESP_OK) return;
+    uint32_t sum[ANALOG_CHANNELS]{}, n[ANALOG_CHANNELS]{};
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+      const auto *p = reinterpret_cast<const adc_digi_output_data_t *>(&buf[i]);
+      const uint32_t channel = HYDRO_ADC_GET_CHANNEL(p);
+      for (uint8_t c = 0; c < ANALOG_CHANNELS; c++) {
+        if (channel == (uint32_t) channel_[c]) {
+          sum[c] += HYDRO_ADC_GET_DATA(p);
+          n[c]++;
+        }
+      }
+    }
+    frames_++;
+    for (uint8_t c = 0; c < ANALOG_CHANNELS; c++) {
+      if (n[c] > 0) filter_[c].push((uint16_t) (sum[c] / n[c]));
+    }
+  }
+
+  // Отфильтрованное напряжение канала; false — данных ещё нет
+  bool read_mv(AnalogChannel c, int32_t *mv) const {
+    if (!filter_[c].ready()) return false;
+    const int raw = filter_[c].value();
+    int out;
+    if (cali_ != nullptr && adc_cali_raw_to_voltage(cali_, raw, &out) == ESP_OK) {
+      *mv = out;
+    } else {
+      // Без калибровки eFuse: приблизительная шкала для 12 dB
+      *mv = raw * 3100 / ((1 << SOC_ADC_DIGI_MAX_BITWIDTH) - 1);
+    }
+    return true;
+  }
+
+  uint32_t frames() const { return frames_; }
+
+ protected:
+  bool fail_() {
+    adc_continuous_deinit(handle_);
+    handle_ = nullptr;
+    return false;
+  }
+
+  void init_calibration_() {
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t c{};
+    c.unit_id = ADC_UNIT_1;
+    c.atten = ADC_ATTEN_DB_12;
+    c.bitwidth = ADC_BITWIDTH_DEFAULT;
+    if (adc_cali_create_scheme_curve_fitting(&c, &cali_) != ESP_OK) cali_ = nullptr;
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_line_fitting_config_t c{};
+    c.unit_id = ADC_UNIT_1;
+    c.atten = ADC_ATTEN_DB_12;
+    c.bitwidth = ADC_BITWIDTH_DEFAULT;
+    if (adc_cali_create_scheme_line_fitting(&c, &cali_) != ESP_OK) cali_ = nullptr;
+#endif
+  }
+
+  adc_continuous_handle_t handle_{nullptr};
+  adc_cali_handle_t cali_{nullptr};
+  adc_channel_t channel_[ANALOG_CHANNELS]{};
+  ChannelFilter filter_[ANALOG_CHANNELS];
+  uint32_t frames_{0};
+};
+
+#endif  // USE_HYDRO_ANALOG
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Каналов каждого типа (помп и светильников) на один контроллер
+static const uint8_t MAX_CHANNELS = 4;
+
+// Расписания каналов одного типа в виде структуры массивов: индекс — номер канала.
+// Для помп on/off — длительности фаз в минутах, для света — минуты суток начала и конца окна.
+struct ScheduleTable {
+  uint8_t count{0};
+  bool enabled[MAX_CHANNELS]{};
+  uint16_t on_minutes[MAX_CHANNELS]{};
+  uint16_t off_minutes[MAX_CHANNELS]{};
+
+  // Новый канал со значениями по умолчанию; false — таблица заполнена
+  bool add(bool en, uint16_t on, uint16_t off) {
+    if (count >= MAX_CHANNELS) return false;
+    enabled[count] = en;
+    on_minutes[count] = on;
+    off_minutes[count] = off;
+    count++;
+    return true;
+  }
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
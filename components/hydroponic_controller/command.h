@@ -0,0 +1,95 @@
+#pragma once
+
+#include "channels.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Поля команды управления; один набор для POST-маршрутов и /api/batch
+enum CommandField : uint8_t {
+  CMD_PUMP_ON = 0,
+  CMD_PUMP_SPEED,
+  CMD_PUMP_SCHED_ENABLED,
+  CMD_PUMP_SCHED_ON,
+  CMD_PUMP_SCHED_OFF,
+  CMD_LIGHT_ON,
+  CMD_LIGHT_BRIGHTNESS,
+  CMD_LIGHT_SCHED_ENABLED,
+  CMD_LIGHT_SCHED_ON,
+  CMD_LIGHT_SCHED_OFF,
+  CMD_CHANNEL,  // номер канала помпы и света, к которым относится команда
+  CMD_COUNT,
+};
+
+struct CommandFieldInfo {
+  const char *key;
+  int16_t min;
+  int16_t max;
+};
+
+// Имена ключей /api/batch и допустимые диапазоны значений
+static const CommandFieldInfo COMMAND_FIELDS[CMD_COUNT] = {
+    {"pump_on", 0, 1},
+    {"pump_speed", 0, 100},
+    {"pump_sched_enabled", 0, 1},
+    {"pump_sched_on", 1, 120},
+    {"pump_sched_off", 1, 120},
+    {"light_on", 0, 1},
+    {"light_brightness", 0, 100},
+    {"light_sched_enabled", 0, 1},
+    {"light_sched_on", 0, 1439},
+    {"light_sched_off", 0, 1439},
+    {"ch", 0, MAX_CHANNELS - 1},
+};
+
+// Набор изменений; применяются только поля, отмеченные в mask
+struct Command {
+  uint16_t mask = 0;
+  int16_t value[CMD_COUNT] = {};
+
+  bool has(CommandField f) const { return mask & (1u << f); }
+  int get(CommandField f) const { return value[f]; }
+  void set(CommandField f, int v) {
+    mask |= (1u << f);
+    value[f] = v;
+  }
+  // Значение приводится к допустимому диапазону (поведение отдельных POST-маршрутов)
+  void set_clamped(CommandField f, int v) {
+    const auto &info = COMMAND_FIELDS[f];
+    set(f, v < info.min ? info.min : (v > info.max ? info.max : v));
+  }
+
+  uint8_t channel() const { return has(CMD_CHANNEL) ? value[CMD_CHANNEL] : 0; }
+  bool touches_pump() const {
+    return touches_pump_schedule() || (mask & ((1u << CMD_PUMP_ON) | (1u << CMD_PUMP_SPEED)));
+  }
+  bool touches_light() const {
+    return touches_light_schedule() || (mask & ((1u << CMD_LIGHT_ON) | (1u << CMD_LIGHT_BRIGHTNESS)));
+  }
+
+  bool touches_pump_schedule() const {
+    return mask & ((1u << CMD_PUMP_SCHED_ENABLED) | (1u << CMD_PUMP_SCHED_ON) | (1u << CMD_PUMP_SCHED_OFF));
+  }
+  bool touches_light_schedule() const {
+    return mask & ((1u << CMD_LIGHT_SCHED_ENABLED) | (1u << CMD_LIGHT_SCHED_ON) | (1u << CMD_LIGHT_SCHED_OFF));
+  }
+
+  // Хотя бы одно поле, кроме номера канала
+  bool has_changes() const { return (mask & ~(1u << CMD_CHANNEL)) != 0; }
+
+  // Строгий разбор значения параметра /api/batch: false, если это не целое число
+  // или оно вне диапазона поля; поле при этом не меняется
+  bool parse_value(CommandField f, const char *text) {
+    char *end = nullptr;
+    const long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < COMMAND_FIELDS[f].min || v > COMMAND_FIELDS[f].max) return false;
+    set(f, (int) v);
+    return true;
+  }
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+enum EventType : uint8_t {
+  EVENT_BOOT = 0,
+  EVENT_PUMP_EDGE,       // переход цикла помпы; value: 1 — ON, 0 — OFF
+  EVENT_LIGHT_EDGE,      // переключение света по окну расписания
+  EVENT_COMMAND,         // поле команды API; field — CommandField, value — значение
+  EVENT_SETTINGS_SAVED,  // value — длительность записи, мкс
+  EVENT_NVS_FAILURE,
+  EVENT_TYPE_COUNT,
+};
+
+// Имена типов в /api/events
+static const char *const EVENT_TYPE_NAMES[EVENT_TYPE_COUNT] = {
+    "boot", "pump_edge", "light_edge", "command", "settings_saved", "nvs_failure",
+};
+
+struct Event {
+  uint32_t seq;
+  uint32_t ms;  // millis() в момент события
+  EventType type;
+  uint8_t channel;
+  uint8_t field;
+  int32_t value;
+};
+
+// Кольцо последних N событий без блокировок: писать можно из loop() и задач httpd
+// одновременно. Номер события выдаёт fetch_add, слот — номер по модулю N; слот помечен
+// номером записанного в него события, как seqlock: читатель копирует поля и проверяет,
+// что метка до и после копирования одна и та же. Номера начинаются с 1.
+// Два писателя столкнутся в одном слоте, только если между ними N событий, — при N
+// в десятки и трёх задачах-источниках этого не бывает.
+template<uint16_t N> class EventLog {
+  static_assert(N != 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+ public:
+  static const uint16_t SIZE = N;
+
+  uint32_t push(EventType type, uint8_t channel, uint8_t field, int32_t value, uint32_t ms) {
+    const uint32_t seq = next_.fetch_add(1, std::memory_order_relaxed) + 1;
+    Slot &s = slots_[seq & (N - 1)];
+    s.stamp.store(0, std::memory_order_relaxed);  // слот пишется
+    std::atomic_thread_fence(std::memory_order_release);
+    s.ms.store(ms, std::memory_order_relaxed);
+    s.info.store(type | (channel << 8) | ((uint32_t) field << 16), std::memory_order_relaxed);
+    s.value.store(value, std::memory_order_relaxed);
+    s.stamp.store(seq, std::memory_order_release);
+    return seq;
+  }
+
+  // Номер последнего выданного события (запись может ещё идти)
+  uint32_t last() const { return next_.load(std::memory_order_acquire); }
+  // Самое старое событие, которое ещё может быть в кольце
+  uint32_t oldest() const {
+    const uint32_t n = last();
+    return n > N ? n - N + 1 : 1;
+  }
+
+  // false — событие ещё пишется (seq >= oldest()) или уже перезаписано (seq < oldest())
+  bool read(uint32_t seq, Event *out) const {
+    const Slot &s = slots_[seq & (N - 1)];
+    if (s.stamp.load(std::memory_order_acquire) != seq) return false;
+    const uint32_t ms = s.ms.load(std::memory_order_relaxed);
+    const uint32_t info = s.info.load(std::memory_order_relaxed);
+    const int32_t value = s.value.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.stamp.load(std::memory_order_relaxed) != seq) return false;
+    out->seq = seq;
+    out->ms = ms;
+    out->type = static_cast<EventType>(info & 0xFF);
+    out->channel = (info >> 8) & 0xFF;
+    out->field = (info >> 16) & 0xFF;
+    out->value = value;
+    return true;
+  }
+
+ protected:
+  struct Slot {
+    std::atomic<uint32_t> stamp{0};
+    std::atomic<uint32_t> ms{0};
+    std::atomic<uint32_t> info{0};
+    std::atomic<int32_t> value{0};
+  };
+
+  Slot slots_[N];
+  std::atomic<uint32_t> next_{0};
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Заголовок блока истории одного ряда (little-endian, как в памяти ESP32).
+// Первая точка хранится в заголовке как есть, каждая следующая — zigzag-varint
+// delta-of-delta метки времени (секунды epoch) и varint XOR битов float с предыдущим значением.
+// /api/history?format=bin отдаёт блоки как есть: первые used байт каждого.
+struct HistoryBlockHeader {
+  uint8_t series;
+  uint8_t version;
+  uint16_t count;
+  uint16_t used;  // байт, включая заголовок
+  uint16_t reserved;
+  uint32_t first_ts;
+  uint32_t last_ts;
+  uint32_t first_bits;
+};
+static_assert(sizeof(HistoryBlockHeader) == 20, "history block header layout");
+
+static const uint16_t HISTORY_BLOCK_SIZE = 256;
+static const uint8_t HISTORY_BLOCK_VERSION = 1;
+
+struct HistoryBlock {
+  HistoryBlockHeader h;
+  uint8_t data[HISTORY_BLOCK_SIZE - sizeof(HistoryBlockHeader)];
+};
+
+inline uint32_t float_bits(float v) {
+  uint32_t b;
+  memcpy(&b, &v, sizeof(b));
+  return b;
+}
+inline float bits_float(uint32_t b) {
+  float v;
+  memcpy(&v, &b, sizeof(v));
+  return v;
+}
+inline uint32_t zigzag(int32_t v) { return ((uint32_t) v << 1) ^ (uint32_t) (v >> 31); }
+inline int32_t unzigzag(uint32_t v) { return (int32_t) (v >> 1) ^ -(int32_t) (v & 1); }
+
+inline uint8_t put_varint(uint8_t *p, uint32_t v) {
+  uint8_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = (uint8_t) (v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = (uint8_t) v;
+  return n;
+}
+
+inline bool get_varint(const uint8_t *&p, const uint8_t *end, uint32_t *out) {
+  uint32_t v = 0;
+  for (uint8_t shift = 0; p < end && shift < 35; shift += 7) {
+    const uint8_t b = *p++;
+    v |= (uint32_t) (b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      *out = v;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Последовательное чтение точек из копии блока
+class HistoryBlockReader {
+ public:
+  explicit HistoryBlockReader(const HistoryBlock &b)
+      : b_(b), p_(b.data), end_(reinterpret_cast<const uint8_t *>(&b) + b.h.used) {}
+
+  bool next(uint32_t *ts, float *value) {
+    if (i_ >= b_.h.count) return false;
+    if (i_ == 0) {
+      ts_ = b_.h.first_ts;
+      bits_ = b_.h.first_bits;
+    } else {
+      uint32_t dod, x;
+      if (!get_varint(p_, end_, &dod) || !get_varint(p_, end_, &x)) return false;
+      delta_ += (uint32_t) unzigzag(dod);
+      ts_ += delta_;
+      bits_ ^= x;
+    }
+    i_++;
+    *ts = ts_;
+    *value = bits_float(bits_);
+    return true;
+  }
+
+ protected:
+  const HistoryBlock &b_;
+  const uint8_t *p_;
+  const uint8_t *end_;
+  uint16_t i_{0};
+  uint32_t ts_{0};
+  uint32_t delta_{0};
+  uint32_t bits_{0};
+};
+
+// Кольцо блоков фиксированного размера в RAM, выделяется один раз в setup().
+// У каждого ряда один открытый блок, в который дописываются точки; заполненный блок
+// закрывается, а новый берётся из кольца на месте самого старого закрытого.
+// Блоки каждого ряда связаны в список в порядке записи, так что читатель находит
+// следующий блок за O(1), а не перебором кольца.
+// Запись — из loop(), чтение — из задачи httpd: оба под lock_, читатель копирует по блоку.
+class HistoryStore {
+ public:
+  static const uint8_t MAX_SERIES = 8;
+  static const uint16_t NONE = 0xFFFF;
+
+  // Позиция читателя между вызовами copy_next(); seq отличает вытесненный слот
+  struct Cursor {
+    uint16_t slot{NONE};
+    uint32_t seq{0};
+  };
+
+  bool init(size_t bytes) {
+    const size_t n = bytes / sizeof(HistoryBlock);
+    if (n <= MAX_SERIES || n >= NONE) return false;
+    blocks_ = new (std::nothrow) HistoryBlock[n];
+    seq_ = new (std::nothrow) uint32_t[n]();
+    links_ = new (std::nothrow) Link[n];
+    if (blocks_ == nullptr || seq_ == nullptr || links_ == nullptr) {
+      delete[] blocks_;
+      delete[] seq_;
+      delete[] links_;
+      blocks_ = nullptr;
+      seq_ = nullptr;
+      links_ = nullptr;
+      return false;
+    }
+    for (uint8_t s = 0; s < MAX_SERIES; s++) head_[s] = tail_[s] = NONE;
+    count_ = n;
+    return true;
+  }
+
+  bool enabled() const { return blocks_ != nullptr; }
+  uint16_t block_count() const { return count_; }
+  uint32_t samples() const { return samples_; }
+
+  void append(uint8_t series, uint32_t ts, float value) {
+    if (blocks_ == nullptr || series >= MAX_SERIES) return;
+    const uint32_t bits = float_bits(value);
+    LockGuard guard(lock_);
+    Open &o = open_[series];
+    samples_++;
+    if (o.slot != NONE) {
+      HistoryBlock &b = blocks_[o.slot];
+      const uint32_t delta = ts - b.h.last_ts;
+      uint8_t tmp[10];
+      uint8_t n = put_varint(tmp, zigzag((int32_t) (delta - o.delta)));
+      n += put_varint(tmp + n, bits ^ o.bits);
+      if (b.h.used + n <= HISTORY_BLOCK_SIZE && b.h.count < UINT16_MAX) {
+        memcpy(reinterpret_cast<uint8_t *>(&b) + b.h.used, tmp, n);
+        b.h.used += n;
+        b.h.count++;
+        b.h.last_ts = ts;
+        o.delta = delta;
+        o.bits = bits;
+        return;
+      }
+    }
+    const uint16_t slot = take_slot_();
+    HistoryBlock &b = blocks_[slot];
+    b.h = {series, HISTORY_BLOCK_VERSION, 1, sizeof(HistoryBlockHeader), 0, ts, ts, bits};
+    seq_[slot] = ++last_seq_;
+    link_back_(series, slot);
+    o = {slot, 0, bits};
+  }
+
+  // Копирует в out следующий по порядку записи блок ряда после cursor, пересекающийся
+  // с [from, to], и сдвигает cursor на него. false — блоков больше нет.
+  // Начальный Cursor{} — с самого старого блока ряда.
+  bool copy_next(uint8_t series, Cursor *cursor, uint32_t from, uint32_t to, HistoryBlock *out) {
+    if (blocks_ == nullptr || series >= MAX_SERIES) return false;
+    LockGuard guard(lock_);
+    uint16_t slot;
+    if (cursor->slot == NONE) {
+      slot = head_[series];
+    } else if (seq_[cursor->slot] == cursor->seq) {
+      slot = links_[cursor->slot].next;
+    } else {
+      // Блок вытеснили между вызовами: продолжаем с первого более нового в ряду
+      slot = head_[series];
+      while (slot != NONE && seq_[slot] <= cursor->seq) slot = links_[slot].next;
+    }
+    for (; slot != NONE; slot = links_[slot].next) {
+      const HistoryBlockHeader &h = blocks_[slot].h;
+      if (h.last_ts < from || h.first_ts > to) continue;
+      memcpy(out, &blocks_[slot], h.used);
+      *cursor = {slot, seq_[slot]};
+      return true;
+    }
+    return false;
+  }
+
+ protected:
+  struct Open {
+    uint16_t slot{NONE};
+    uint32_t delta{0};
+    uint32_t bits{0};
+  };
+  struct Link {
+    uint16_t prev{NONE};
+    uint16_t next{NONE};
+  };
+
+  void link_back_(uint8_t series, uint16_t slot) {
+    links_[slot] = {tail_[series], NONE};
+    if (tail_[series] != NONE) {
+      links_[tail_[series]].next = slot;
+    } else {
+      head_[series] = slot;
+    }
+    tail_[series] = slot;
+  }
+
+  // Обычно вытесняется голова ряда, но открытый блок пропускается курсором кольца,
+  // поэтому список двусвязный и слот вынимается из любого места
+  void unlink_(uint16_t slot) {
+    const uint8_t series = blocks_[slot].h.series;
+    const Link l = links_[slot];
+    if (l.prev != NONE) {
+      links_[l.prev].next = l.next;
+    } else {
+      head_[series] = l.next;
+    }
+    if (l.next != NONE) {
+      links_[l.next].prev = l.prev;
+    } else {
+      tail_[series] = l.prev;
+    }
+  }
+
+  bool is_open_(uint16_t slot) const {
+    for (const auto &o : open_) {
+      if (o.slot == slot) return true;
+    }
+    return false;
+  }
+
+  // Открытые блоки не вытесняются; count_ > MAX_SERIES гарантирует свободный слот
+  uint16_t take_slot_() {
+    for (;;) {
+      const uint16_t slot = cursor_;
+      cursor_ = (cursor_ + 1) % count_;
+      if (is_open_(slot)) continue;
+      if (seq_[slot] != 0) unlink_(slot);
+      return slot;
+    }
+  }
+
+  HistoryBlock *blocks_{nullptr};
+  uint32_t *seq_{nullptr};  // 0 — слот пуст
+  Link *links_{nullptr};
+  uint16_t head_[MAX_SERIES];  // самый старый блок ряда
+  uint16_t tail_[MAX_SERIES];  // самый новый
+  uint16_t count_{0};
+  uint16_t cursor_{0};
+  uint32_t last_seq_{0};
+  uint32_t samples_{0};
+  Open open_[MAX_SERIES];
+  Mutex lock_;
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
@@ -1,228 +1,763 @@
 #pragma once
 
 #include "esphome/core/component.h"
+#include "esphome/core/defines.h"
 #include "esphome/core/preferences.h"
 #include "esphome/components/fan/fan.h"
 #include "esphome/components/light/light_state.h"
+#include "esphome/components/sensor/sensor.h"
 #include "esphome/components/time/real_time_clock.h"
+#ifdef USE_HYDRO_REST_API
 #include "esphome/components/web_server/web_server.h"
 #include "esphome/components/web_server_base/web_server_base.h"
 #include "esphome/components/web_server_idf/web_server_idf.h"
+#endif
+#ifdef USE_HYDRO_POWER_SAVE
+#include "esphome/core/application.h"
+#endif
+#include "analog_sampler.h"
+#include "channels.h"
+#include "command.h"
+#include "event_log.h"
+#include "history_store.h"
+#include "metrics.h"
+#include "power_save.h"
+#include "scheduler.h"
+#include "settings_format.h"
+#include "settings_store.h"
+#include "state_snapshot.h"
+#include "state_stream.h"
+#include "ws_server.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Состав прошивки задаётся флагами в __init__.py: pump_schedule, light_schedule,
+// rest_api, web_ui, websocket -> USE_HYDRO_PUMP_SCHEDULE, USE_HYDRO_LIGHT_SCHEDULE,
+// USE_HYDRO_REST_API, USE_HYDRO_WEB_UI, USE_HYDRO_WS. Выключенные части не компилируются.
+
+#ifdef USE_HYDRO_WEB_UI
+// Веб-интерфейс: gzip-массив во flash, генерируется из index.html в __init__.py
+extern const uint8_t HYDROPONIC_INDEX_HTML[];
+extern const size_t HYDROPONIC_INDEX_HTML_SIZE;
+extern const char HYDROPONIC_INDEX_ETAG[];
+#endif
 
 namespace esphome {
 namespace hydroponic_controller {
 
 static const char *const TAG = "hydroponic_controller";
 
-// Структура для хранения настроек в энергонезависимой памяти
-struct Settings {
-  bool enabled = false;
-  int on_minutes = 5;
-  int off_minutes = 15;
-  bool light_sched_enabled = false;
-  int light_on_minutes = 1080;   // 18:00
-  int light_off_minutes = 540;   // 09:00
-  uint32_t crc = 0;
-  
-  uint32_t calculate_crc() const {
-    uint32_t hash = 2166136261u;
-    const uint8_t *data = reinterpret_cast<const uint8_t*>(this);
-    for (size_t i = 0; i < sizeof(Settings) - sizeof(crc); i++) {
-      hash ^= data[i];
-      hash *= 16777619u;
-    }
-    return hash;
-  }
+// Правила расписания в очереди дедлайнов; у каждого канала помпы и света своё правило
+enum ScheduleRule : uint8_t {
+  RULE_HISTORY = 0,
+  RULE_ANALOG = 1,
+  RULE_PUMP = 2,                          // + номер канала
+  RULE_LIGHT = RULE_PUMP + MAX_CHANNELS,  // + номер канала
+};
+static const uint8_t MAX_RULES = 16;
+static_assert(RULE_LIGHT + MAX_CHANNELS <= MAX_RULES, "rearm_ mask and deadline queue are sized for MAX_RULES");
+// Окно света перепроверяется не реже раза в час (переход на летнее время и т.п.)
+static const uint32_t LIGHT_RECHECK_MS = 60 * 60 * 1000UL;
+static const uint32_t CLOCK_RETRY_MS = 1000;
+// Событий в кольце /api/events (по 16 байт)
+static const uint16_t EVENT_LOG_SIZE = 64;
+
+// Ряды истории: переходы помпы и света канала 0, затем датчики из history_sensors
+enum HistorySeries : uint8_t {
+  SERIES_PUMP = 0,
+  SERIES_LIGHT = 1,
+  SERIES_FIRST_SENSOR = 2,
+};
+static const uint8_t MAX_HISTORY_SENSORS = HistoryStore::MAX_SERIES - SERIES_FIRST_SENSOR;
+
+// Каналы помп: структура массивов, индекс — номер канала
+struct PumpChannels {
+  fan::Fan *fan[MAX_CHANNELS]{};
+  ScheduleTable sched;  // enabled, длительности ON/OFF в минутах
+  bool running_on[MAX_CHANNELS]{};
+  uint32_t last_change_ms[MAX_CHANNELS]{};
+};
+
+// Каналы света; window_state — последнее состояние окна расписания, -1 неизвестно
+struct LightChannels {
+  light::LightState *light[MAX_CHANNELS]{};
+  ScheduleTable sched;  // enabled, начало и конец окна в минутах суток
+  int8_t window_state[MAX_CHANNELS]{};
 };
 
 class HydroponicController : public Component {
  public:
-  void set_pump(fan::Fan *pump) { pump_ = pump; }
-  void set_light(light::LightState *light) { light_ = light; }
+  // Каналы нумеруются в порядке добавления
+  void add_pump(fan::Fan *pump) {
+    const uint8_t ch = pumps_.sched.count;
+    if (pumps_.sched.add(false, 5, 15)) pumps_.fan[ch] = pump;
+  }
+  void add_light(light::LightState *light) {
+    const uint8_t ch = lights_.sched.count;
+    if (lights_.sched.add(false, 1080, 540)) {  // 18:00 - 09:00
+      lights_.light[ch] = light;
+      lights_.window_state[ch] = -1;
+    }
+  }
   void set_clock(time::RealTimeClock *clock) { clock_ = clock; }
+#ifdef USE_HYDRO_REST_API
   void set_server(web_server::WebServer *server) { server_ = server; }
-  void set_durations(int on_min, int off_min) { 
-    on_minutes_ = on_min; 
-    off_minutes_ = off_min; 
+  void set_max_stream_clients(uint8_t n) { stream_.set_max_clients(n); }
+#endif
+#ifdef USE_HYDRO_WS
+  void set_ws_port(uint16_t port) { ws_.set_port(port); }
+  void set_max_ws_clients(uint8_t n) { ws_.set_max_clients(n); }
+#endif
+  // Значения по умолчанию для всех каналов помп; сохранённые настройки их перекрывают
+  void set_durations(int on_min, int off_min) {
+    for (uint8_t ch = 0; ch < pumps_.sched.count; ch++) {
+      pumps_.sched.on_minutes[ch] = on_min;
+      pumps_.sched.off_minutes[ch] = off_min;
+    }
+  }
+  void set_enabled(bool e) {
+    for (uint8_t ch = 0; ch < pumps_.sched.count; ch++) pumps_.sched.enabled[ch] = e;
   }
-  void set_enabled(bool e) { enabled_ = e; }
+  void set_save_delay(uint32_t ms) { store_.set_debounce(ms); }
+  void set_history_size(uint32_t bytes) { history_size_ = bytes; }
+  void set_history_interval(uint32_t ms) { history_interval_ms_ = ms; }
+  void add_history_sensor(sensor::Sensor *s) {
+    if (history_sensor_count_ < MAX_HISTORY_SENSORS) history_sensors_[history_sensor_count_++] = s;
+  }
+#ifdef USE_HYDRO_ANALOG
+  void set_analog_pins(int ph_pin, int ec_pin) {
+    analog_pins_[ANALOG_PH] = ph_pin;
+    analog_pins_[ANALOG_EC] = ec_pin;
+  }
+  void set_analog_interval(uint32_t ms) { analog_interval_ms_ = ms; }
+  void set_ph_sensor(sensor::Sensor *s) { ph_sensor_ = s; }
+  void set_ec_sensor(sensor::Sensor *s) { ec_sensor_ = s; }
+  void set_water_temperature(sensor::Sensor *s) { water_temp_ = s; }
+  void set_ph_calibration(int neutral_mv, int acid_mv) {
+    ph_neutral_mv_ = neutral_mv;
+    ph_acid_mv_ = acid_mv;
+  }
+  void set_ec_k_value(float k) { ec_k_milli_ = (int32_t) (k * 1000.0f + 0.5f); }
+#endif
+#ifdef USE_HYDRO_POWER_SAVE
+  PowerSave *get_power_save() { return &power_; }
+#endif
 
   void setup() override {
     ESP_LOGI(TAG, "========================================");
     ESP_LOGI(TAG, ">>> Setting up Hydroponic Controller...");
     
     // Загрузка сохранённых настроек из энергонезависимой памяти
-    pref_ = global_preferences->make_preference<Settings>(fnv1_hash("hydro_settings"));
-    Settings loaded;
     ESP_LOGI(TAG, "Attempting to load settings from NVS...");
-    if (pref_.load(&loaded)) {
-      ESP_LOGI(TAG, "Settings found in NVS, checking CRC...");
-      if (loaded.crc == loaded.calculate_crc()) {
-        enabled_ = loaded.enabled;
-        on_minutes_ = loaded.on_minutes;
-        off_minutes_ = loaded.off_minutes;
-        light_sched_enabled_ = loaded.light_sched_enabled;
-        light_on_minutes_ = loaded.light_on_minutes;
-        light_off_minutes_ = loaded.light_off_minutes;
-        ESP_LOGI(TAG, "✓ Settings loaded from flash successfully!");
-        ESP_LOGI(TAG, "  Pump schedule: %s, ON=%dmin, OFF=%dmin", 
-                 enabled_ ? "enabled" : "disabled", on_minutes_, off_minutes_);
-        ESP_LOGI(TAG, "  Light schedule: %s, ON=%02d:%02d, OFF=%02d:%02d",
-                 light_sched_enabled_ ? "enabled" : "disabled",
-                 light_on_minutes_/60, light_on_minutes_%60,
-                 light_off_minutes_/60, light_off_minutes_%60);
+    log_event_(EVENT_BOOT);
+    load_settings_();
+    
+    const uint32_t now = millis();
+    for (uint8_t ch = 0; ch < pumps_.sched.count; ch++) {
+      pumps_.last_change_ms[ch] = now;
+      pumps_.running_on[ch] = false;
+      // Любое изменение помпы или света (в т.ч. из Home Assistant) попадает в поток событий
+      pumps_.fan[ch]->add_on_state_callback([this]() { notify_state_(); });
+    }
+    for (uint8_t ch = 0; ch < lights_.sched.count; ch++)
+      lights_.light[ch]->add_new_remote_values_callback([this]() { notify_state_(); });
+#ifdef USE_HYDRO_LIGHT_SCHEDULE
+    // После синхронизации времени окна света пересчитываются
+    if (clock_ != nullptr) clock_->add_on_time_sync_callback([this]() { request_rearm_all_(RULE_LIGHT, lights_); });
+#endif
+    if (history_size_ > 0) {
+      if (history_.init(history_size_)) {
+        for (uint8_t i = 0; i < history_sensor_count_; i++)
+          snprintf(sensor_names_[i], sizeof(sensor_names_[i]), "%s", history_sensors_[i]->get_object_id().c_str());
+        deadlines_.schedule(RULE_HISTORY, millis() + history_interval_ms_);
       } else {
-        ESP_LOGW(TAG, "✗ Settings CRC mismatch, using defaults");
+        ESP_LOGE(TAG, "✗ History store allocation failed (%u bytes)", history_size_);
       }
+    }
+#ifdef USE_HYDRO_ANALOG
+    if (analog_.begin(analog_pins_)) {
+      deadlines_.schedule(RULE_ANALOG, millis() + analog_interval_ms_);
     } else {
-      ESP_LOGI(TAG, "No saved settings found, using defaults");
+      ESP_LOGE(TAG, "✗ ADC continuous mode failed to start (pH GPIO%d, EC GPIO%d)", analog_pins_[ANALOG_PH],
+               analog_pins_[ANALOG_EC]);
     }
-    
-    last_change_ms_ = millis();
-    running_on_ = false;
+#endif
+#ifdef USE_HYDRO_POWER_SAVE
+    power_.setup();
+#endif
+#ifdef USE_HYDRO_REST_API
     register_routes_();
-    if (enabled_) start_cycle_();
+#endif
+#ifdef USE_HYDRO_WS
+    // Команды из задачи httpd идут через тот же apply_, что и REST
+    ws_.set_on_command([this](const Command &cmd) {
+#ifdef USE_HYDRO_POWER_SAVE
+      power_.note_activity();
+#endif
+      return apply_(cmd) ? WS_OK : WS_UNKNOWN_CHANNEL;
+    });
+    if (!ws_.start()) ESP_LOGE(TAG, "✗ WebSocket server failed to start on port %u", ws_.get_port());
+#endif
+#ifdef USE_HYDRO_PUMP_SCHEDULE
+    for (uint8_t ch = 0; ch < pumps_.sched.count; ch++) {
+      if (pumps_.sched.enabled[ch]) start_cycle_(ch);
+    }
+#endif
+#ifdef USE_HYDRO_LIGHT_SCHEDULE
+    request_rearm_all_(RULE_LIGHT, lights_);
+#endif
     ESP_LOGI(TAG, ">>> Hydroponic Controller setup complete!");
     ESP_LOGI(TAG, "========================================");
   }
 
   void loop() override {
-    // Pump cycle logic
-    if (enabled_) {
-      const uint32_t now = millis();
-      const uint32_t period_ms = (running_on_ ? on_minutes_ : off_minutes_) * 60000UL;
-      if (now - last_change_ms_ >= period_ms) {
-        running_on_ = !running_on_;
-        last_change_ms_ = now;
-        if (running_on_) {
-          if (pump_ != nullptr) {
-            pump_->turn_on().perform();
-            ESP_LOGI(TAG, "Pump ON (scheduled cycle)");
-          }
-        } else {
-          if (pump_ != nullptr) {
-            pump_->turn_off().perform();
-            ESP_LOGI(TAG, "Pump OFF (scheduled cycle)");
-          }
-        }
+    const uint32_t loop_start_us = micros();
+    const uint32_t now = millis();
+    // Перевзвод правил после изменений из API
+    if (rearm_ != 0) {
+      const uint16_t rules = rearm_.exchange(0);
+#ifdef USE_HYDRO_PUMP_SCHEDULE
+      for (uint8_t ch = 0; ch < pumps_.sched.count; ch++) {
+        if (rules & (1u << (RULE_PUMP + ch))) arm_pump_(ch);
+      }
+#endif
+#ifdef USE_HYDRO_LIGHT_SCHEDULE
+      for (uint8_t ch = 0; ch < lights_.sched.count; ch++) {
+        if (rules & (1u << (RULE_LIGHT + ch))) arm_light_(ch, true);
       }
+#endif
+      (void) rules;
     }
 
-    // Light schedule logic
-    if (light_sched_enabled_ && clock_ != nullptr) {
-      auto time = clock_->now();
-      if (time.is_valid()) {
-        int current_minutes = time.hour * 60 + time.minute;
-        bool should_be_on = false;
-        
-        if (light_on_minutes_ < light_off_minutes_) {
-          should_be_on = (current_minutes >= light_on_minutes_ && current_minutes < light_off_minutes_);
-        } else {
-          should_be_on = (current_minutes >= light_on_minutes_ || current_minutes < light_off_minutes_);
-        }
-        
-        if (light_ != nullptr) {
-          bool is_on = light_->current_values.is_on();
-          if (should_be_on && !is_on) {
-            light_->turn_on().perform();
-            ESP_LOGI(TAG, "Lighting ON (scheduled)");
-          } else if (!should_be_on && is_on) {
-            light_->turn_off().perform();
-            ESP_LOGI(TAG, "Lighting OFF (scheduled)");
-          }
-        }
+    // Schedule edges: до ближайшего дедлайна ничего не пересчитывается
+    while (deadlines_.due(now)) {
+      const uint32_t deadline = deadlines_.next_deadline();
+      const uint8_t rule = deadlines_.pop();
+      switch (rule) {
+        case RULE_HISTORY:
+          sample_history_();
+          deadlines_.schedule(RULE_HISTORY, deadline + history_interval_ms_);
+          break;
+#ifdef USE_HYDRO_ANALOG
+        case RULE_ANALOG:
+          publish_analog_();
+          deadlines_.schedule(RULE_ANALOG, deadline + analog_interval_ms_);
+          break;
+#endif
+        default:
+#ifdef USE_HYDRO_PUMP_SCHEDULE
+          if (rule >= RULE_PUMP && rule < RULE_LIGHT) on_pump_edge_(rule - RULE_PUMP, deadline);
+#endif
+#ifdef USE_HYDRO_LIGHT_SCHEDULE
+          if (rule >= RULE_LIGHT) arm_light_(rule - RULE_LIGHT, false);
+#endif
+          break;
       }
     }
+
+#ifdef USE_HYDRO_ANALOG
+    // Кадр АЦП, если DMA успел его заполнить; без ожидания
+    analog_.poll();
+#endif
+
+    // Отложенная запись настроек
+    if (store_.due(now)) flush_settings_();
+
+    // State stream и WebSocket (без них — только переходы для истории)
+    bool publish = state_dirty_;
+#ifdef USE_HYDRO_REST_API
+    publish = publish || stream_.has_fresh();
+#endif
+#ifdef USE_HYDRO_WS
+    publish = publish || ws_.has_fresh();
+#endif
+    if (publish) publish_state_();
+#ifdef USE_HYDRO_REST_API
+    stream_.keepalive(now);
+#endif
+
+    metrics_.record_loop(micros() - loop_start_us);
+
+#ifdef USE_HYDRO_POWER_SAVE
+    // В конце итерации: всё отложенное уже сделано, спим до следующего дедлайна
+    power_.idle(millis(), sleep_budget_ms_(millis()), outputs_steady_());
+#endif
   }
 
   void dump_config() override {
     ESP_LOGCONFIG(TAG, "Hydroponic Controller:");
-    ESP_LOGCONFIG(TAG, "  NVS Status: %s", settings_loaded_from_nvs_ ? "✓ Loaded from flash" : "✗ Using defaults");
-    ESP_LOGCONFIG(TAG, "  Pump ON: %d min", on_minutes_);
-    ESP_LOGCONFIG(TAG, "  Pump OFF: %d min", off_minutes_);
-    ESP_LOGCONFIG(TAG, "  Pump Schedule: %s", enabled_ ? "enabled" : "disabled");
-    ESP_LOGCONFIG(TAG, "  Light ON: %02d:%02d", light_on_minutes_/60, light_on_minutes_%60);
-    ESP_LOGCONFIG(TAG, "  Light OFF: %02d:%02d", light_off_minutes_/60, light_off_minutes_%60);
-    ESP_LOGCONFIG(TAG, "  Light Schedule: %s", light_sched_enabled_ ? "enabled" : "disabled");
+    ESP_LOGCONFIG(TAG, "  NVS Status: %s", store_.loaded() ? "✓ Loaded from flash" : "✗ Using defaults");
+    ESP_LOGCONFIG(TAG, "  Channels: %u pump, %u light", pumps_.sched.count, lights_.sched.count);
+#ifdef USE_HYDRO_PUMP_SCHEDULE
+    for (uint8_t ch = 0; ch < pumps_.sched.count; ch++) {
+      ESP_LOGCONFIG(TAG, "  Pump %u: ON %u min, OFF %u min, schedule %s", ch, pumps_.sched.on_minutes[ch],
+                    pumps_.sched.off_minutes[ch], pumps_.sched.enabled[ch] ? "enabled" : "disabled");
+    }
+#else
+    ESP_LOGCONFIG(TAG, "  Pump Schedule: not compiled in");
+#endif
+#ifdef USE_HYDRO_LIGHT_SCHEDULE
+    for (uint8_t ch = 0; ch < lights_.sched.count; ch++) {
+      const uint16_t on = lights_.sched.on_minutes[ch], off = lights_.sched.off_minutes[ch];
+      ESP_LOGCONFIG(TAG, "  Light %u: ON %02u:%02u, OFF %02u:%02u, schedule %s", ch, on / 60, on % 60, off / 60,
+                    off % 60, lights_.sched.enabled[ch] ? "enabled" : "disabled");
+    }
+#else
+    ESP_LOGCONFIG(TAG, "  Light Schedule: not compiled in");
+#endif
+    ESP_LOGCONFIG(TAG, "  Settings Save Delay: %u ms", store_.get_debounce());
+    ESP_LOGCONFIG(TAG, "  Settings Writes: %u (skipped %u, failed %u), max flush %u us",
+                  store_.writes(), store_.skipped(), store_.failures(), store_.max_flush_us());
+#ifdef USE_HYDRO_REST_API
+    ESP_LOGCONFIG(TAG, "  State Stream Clients: %u max", stream_.get_max_clients());
+#ifdef USE_HYDRO_WEB_UI
+    ESP_LOGCONFIG(TAG, "  Web UI: %u bytes (gzip)", (unsigned) HYDROPONIC_INDEX_HTML_SIZE);
+#endif
+#else
+    ESP_LOGCONFIG(TAG, "  REST API: not compiled in");
+#endif
+#ifdef USE_HYDRO_WS
+    ESP_LOGCONFIG(TAG, "  WebSocket: port %u, %u clients max, %s", ws_.get_port(), ws_.get_max_clients(),
+                  ws_.running() ? "running" : "FAILED");
+#endif
+#ifdef USE_HYDRO_ANALOG
+    ESP_LOGCONFIG(TAG, "  Analog: pH GPIO%d, EC GPIO%d, %s, publish every %u ms", analog_pins_[ANALOG_PH],
+                  analog_pins_[ANALOG_EC], analog_.running() ? "running" : "FAILED", analog_interval_ms_);
+    ESP_LOGCONFIG(TAG, "  pH Calibration: %d mV @ 7.0, %d mV @ 4.0; EC K: %d.%03d", ph_neutral_mv_, ph_acid_mv_,
+                  ec_k_milli_ / 1000, ec_k_milli_ % 1000);
+#endif
+#ifdef USE_HYDRO_POWER_SAVE
+    ESP_LOGCONFIG(TAG, "  Power Save: light sleep up to %u ms, awake %u ms after HTTP activity, slept %u.%u%%",
+                  power_.get_max_sleep(), power_.get_awake_after_activity(), power_.sleep_permille() / 10,
+                  power_.sleep_permille() % 10);
+#endif
+    if (history_.enabled()) {
+      ESP_LOGCONFIG(TAG, "  History: %u blocks x %u bytes, %u sensor series, every %u s", history_.block_count(),
+                    HISTORY_BLOCK_SIZE, history_sensor_count_, history_interval_ms_ / 1000);
+    } else {
+      ESP_LOGCONFIG(TAG, "  History: disabled");
+    }
+  }
+
+  // Несохранённые изменения пишутся перед перезагрузкой, в т.ч. перед OTA
+  void on_shutdown() override {
+    if (store_.dirty()) flush_settings_();
   }
 
  protected:
-  void start_cycle_() {
-    last_change_ms_ = millis();
-    running_on_ = true;
-    if (pump_ != nullptr) {
-      pump_->turn_on().perform();
-      ESP_LOGI(TAG, "Pump cycle started");
-    }
+#ifdef USE_HYDRO_PUMP_SCHEDULE
+  void start_cycle_(uint8_t ch) {
+    pumps_.last_change_ms[ch] = millis();
+    pumps_.running_on[ch] = true;
+    pumps_.fan[ch]->turn_on().perform();
+    ESP_LOGI(TAG, "Pump %u cycle started", ch);
+    request_rearm_(RULE_PUMP + ch);
+  }
+
+  void stop_cycle_(uint8_t ch) {
+    pumps_.fan[ch]->turn_off().perform();
+    pumps_.running_on[ch] = false;
+    ESP_LOGI(TAG, "Pump %u cycle stopped", ch);
+    request_rearm_(RULE_PUMP + ch);
+  }
+#endif
+
+  // Может вызываться из задачи httpd; очередь дедлайнов трогает только loop()
+  void request_rearm_(uint8_t rule) { rearm_ |= (1u << rule); }
+  template<typename Channels> void request_rearm_all_(uint8_t first_rule, const Channels &channels) {
+    rearm_ |= ((1u << channels.sched.count) - 1) << first_rule;
   }
 
-  void stop_cycle_() {
-    if (pump_ != nullptr) {
-      pump_->turn_off().perform();
+#ifdef USE_HYDRO_PUMP_SCHEDULE
+  void arm_pump_(uint8_t ch) {
+    if (!pumps_.sched.enabled[ch]) {
+      deadlines_.cancel(RULE_PUMP + ch);
+      return;
     }
-    running_on_ = false;
-    ESP_LOGI(TAG, "Pump cycle stopped");
+    deadlines_.schedule(RULE_PUMP + ch, pumps_.last_change_ms[ch] + pump_phase_ms(pumps_.running_on[ch],
+                                                                                  pumps_.sched.on_minutes[ch],
+                                                                                  pumps_.sched.off_minutes[ch]));
   }
-  
-  void save_settings_() {
-    ESP_LOGI(TAG, ">>> save_settings_() called <<<");
-    Settings s;
-    s.enabled = enabled_;
-    s.on_minutes = on_minutes_;
-    s.off_minutes = off_minutes_;
-    s.light_sched_enabled = light_sched_enabled_;
-    s.light_on_minutes = light_on_minutes_;
-    s.light_off_minutes = light_off_minutes_;
-    s.crc = s.calculate_crc();
-    
-    ESP_LOGI(TAG, "Saving: enabled=%d, on=%d, off=%d, light_sched=%d", 
-             s.enabled, s.on_minutes, s.off_minutes, s.light_sched_enabled);
-    
-    if (pref_.save(&s)) {
-      ESP_LOGI(TAG, "✓ Settings saved to flash successfully!");
+
+  void on_pump_edge_(uint8_t ch, uint32_t deadline) {
+    const bool on = pumps_.running_on[ch] = !pumps_.running_on[ch];
+    // Фаза цикла отсчитывается от дедлайна, а не от момента обработки
+    pumps_.last_change_ms[ch] = deadline;
+    if (on) {
+      pumps_.fan[ch]->turn_on().perform();
+      ESP_LOGI(TAG, "Pump %u ON (scheduled cycle)", ch);
     } else {
+      pumps_.fan[ch]->turn_off().perform();
+      ESP_LOGI(TAG, "Pump %u OFF (scheduled cycle)", ch);
+    }
+    log_event_(EVENT_PUMP_EDGE, ch, 0, on);
+    arm_pump_(ch);
+  }
+#endif
+
+#ifdef USE_HYDRO_LIGHT_SCHEDULE
+  // force: применить окно немедленно (старт, изменение настроек); иначе свет
+  // переключается только на границе окна, и ручное включение/выключение сохраняется до неё
+  void arm_light_(uint8_t ch, bool force) {
+    const uint8_t rule = RULE_LIGHT + ch;
+    if (!lights_.sched.enabled[ch] || clock_ == nullptr) {
+      deadlines_.cancel(rule);
+      lights_.window_state[ch] = -1;
+      return;
+    }
+    const uint32_t now = millis();
+    auto time = clock_->now();
+    if (!time.is_valid()) {
+      deadlines_.schedule(rule, now + CLOCK_RETRY_MS);
+      return;
+    }
+    const int on_minutes = lights_.sched.on_minutes[ch], off_minutes = lights_.sched.off_minutes[ch];
+    const int current_minutes = time.hour * 60 + time.minute;
+    const bool should_be_on = light_window_contains(on_minutes, off_minutes, current_minutes);
+    if (force || lights_.window_state[ch] != (int8_t) should_be_on) {
+      auto *light = lights_.light[ch];
+      bool is_on = light->current_values.is_on();
+      if (should_be_on && !is_on) {
+        light->turn_on().perform();
+        ESP_LOGI(TAG, "Lighting %u ON (scheduled)", ch);
+        log_event_(EVENT_LIGHT_EDGE, ch, 0, 1);
+      } else if (!should_be_on && is_on) {
+        light->turn_off().perform();
+        ESP_LOGI(TAG, "Lighting %u OFF (scheduled)", ch);
+        log_event_(EVENT_LIGHT_EDGE, ch, 0, 0);
+      }
+    }
+    lights_.window_state[ch] = should_be_on;
+    uint32_t wait_ms = ms_to_next_light_edge(on_minutes, off_minutes, current_minutes, time.second);
+    deadlines_.schedule(rule, now + std::min(wait_ms, LIGHT_RECHECK_MS));
+  }
+#endif
+
+  // Формат v2; при его отсутствии — миграция из v1 с записью в новом формате
+  void load_settings_() {
+    store_.init(fnv1_hash("hydro_settings_v2"));
+    PackedSettings packed;
+    if (store_.load(&packed)) {
+      if (decode_settings(packed, &pumps_.sched, &lights_.sched)) {
+        ESP_LOGI(TAG, "✓ Settings loaded from flash successfully! (v%u, %u pump / %u light channels stored)",
+                 packed.bytes[2], packed.bytes[3], packed.bytes[4]);
+        return;
+      }
+      ESP_LOGW(TAG, "✗ Stored settings have an unknown format, using defaults");
+      return;
+    }
+    SettingsStore<LegacySettings> legacy;
+    legacy.init(fnv1_hash("hydro_settings"));
+    LegacySettings old;
+    if (legacy.load(&old)) {
+      migrate_settings(old, &pumps_.sched, &lights_.sched);
+      save_settings_();
+      ESP_LOGI(TAG, "✓ Settings migrated from v1 to channel 0, will be saved as v2");
+      return;
+    }
+    ESP_LOGI(TAG, "No valid saved settings found, using defaults");
+  }
+
+  // Вызывается из обработчиков API: только помечает настройки, запись — в loop()
+  void save_settings_() { store_.mark_dirty(); }
+
+  void flush_settings_() {
+    const uint32_t writes = store_.writes();
+    if (!store_.flush([this](PackedSettings *s) { encode_settings(pumps_.sched, lights_.sched, s); })) {
+      metrics_.record_nvs_flush(store_.last_flush_us());
+      log_event_(EVENT_NVS_FAILURE);
       ESP_LOGE(TAG, "✗ FAILED to save settings to flash!");
+    } else if (store_.writes() != writes) {
+      metrics_.record_nvs_flush(store_.last_flush_us());
+      log_event_(EVENT_SETTINGS_SAVED, 0, 0, store_.last_flush_us());
+      ESP_LOGI(TAG, "✓ Settings saved to flash in %u us (writes=%u, skipped=%u)",
+               store_.last_flush_us(), store_.writes(), store_.skipped());
+    } else {
+      ESP_LOGD(TAG, "Settings unchanged, flash write skipped (skipped=%u)", store_.skipped());
     }
   }
 
+#ifdef USE_HYDRO_REST_API
   void register_routes_();
-  std::string build_index_() const;
+#endif
+  bool apply_(const Command &cmd);
+
+  StateSnapshot snapshot_() const {
+    StateSnapshot s;
+    s.pump_count = pumps_.sched.count;
+    s.light_count = lights_.sched.count;
+    for (uint8_t ch = 0; ch < pumps_.sched.count; ch++) {
+      ChannelState &c = s.pumps[ch];
+      c.on = pumps_.fan[ch]->state;
+      c.level = pumps_.fan[ch]->speed;
+      c.sched = pumps_.sched.enabled[ch];
+      c.on_minutes = pumps_.sched.on_minutes[ch];
+      c.off_minutes = pumps_.sched.off_minutes[ch];
+    }
+    for (uint8_t ch = 0; ch < lights_.sched.count; ch++) {
+      ChannelState &c = s.lights[ch];
+      const auto &v = lights_.light[ch]->current_values;
+      c.on = v.is_on();
+      c.level = (int)(v.get_brightness() * 100.0f + 0.5f);
+      c.sched = lights_.sched.enabled[ch];
+      c.on_minutes = lights_.sched.on_minutes[ch];
+      c.off_minutes = lights_.sched.off_minutes[ch];
+    }
+    return s;
+  }
+
+  // Может вызываться из задачи httpd; отправка происходит в loop()
+  void notify_state_() { state_dirty_ = true; }
+
+  // Из любой задачи
+  void log_event_(EventType type, uint8_t channel = 0, uint8_t field = 0, int32_t value = 0) {
+    events_.push(type, channel, field, value, millis());
+  }
+
+  // Метка времени истории; false — часы ещё не синхронизированы
+  bool history_now_(uint32_t *ts) const {
+    if (!history_.enabled() || clock_ == nullptr) return false;
+    const auto time = clock_->now();
+    if (!time.is_valid()) return false;
+    *ts = (uint32_t) time.timestamp;
+    return true;
+  }
+
+  // В историю попадают только переходы: значение помпы — скорость (0 если выключена),
+  // света — яркость
+  void record_actuators_(const StateSnapshot &s) {
+    uint32_t ts;
+    if (!history_now_(&ts)) return;
+    const int16_t pump = s.pumps[0].on ? s.pumps[0].level : 0;
+    const int16_t light = s.lights[0].on ? s.lights[0].level : 0;
+    if (pump != recorded_pump_) history_.append(SERIES_PUMP, ts, pump);
+    if (light != recorded_light_) history_.append(SERIES_LIGHT, ts, light);
+    recorded_pump_ = pump;
+    recorded_light_ = light;
+  }
+
+  void sample_history_() {
+    uint32_t ts;
+    if (!history_now_(&ts)) return;
+    for (uint8_t i = 0; i < history_sensor_count_; i++) {
+      const float v = history_sensors_[i]->state;
+      if (!std::isnan(v)) history_.append(SERIES_FIRST_SENSOR + i, ts, v);
+    }
+    record_actuators_(snapshot_());
+  }
+
+#ifdef USE_HYDRO_ANALOG
+  // Публикация с частотой analog_interval_ms_; фильтры обновляются в каждом loop()
+  void publish_analog_() {
+    int32_t temp_mc = 25000;  // без датчика температуры компенсация к 25 °C не применяется
+    if (water_temp_ != nullptr && !std::isnan(water_temp_->state)) temp_mc = (int32_t) (water_temp_->state * 1000.0f);
+    int32_t mv;
+    if (ph_sensor_ != nullptr && analog_.read_mv(ANALOG_PH, &mv))
+      ph_sensor_->publish_state(ph_milli(mv, ph_neutral_mv_, ph_acid_mv_, temp_mc) / 1000.0f);
+    if (ec_sensor_ != nullptr && analog_.read_mv(ANALOG_EC, &mv))
+      ec_sensor_->publish_state(ec_us_cm(mv, ec_k_milli_, temp_mc) / 1000.0f);  // мСм/см
+  }
+#endif
+
+#ifdef USE_HYDRO_POWER_SAVE
+  // Сколько можно спать до ближайшего дедлайна — своего или таймера любого компонента в
+  // App.scheduler; 0 — есть работа, открыт поток событий/WebSocket или планировщик пуст
+  uint32_t sleep_budget_ms_(uint32_t now) const {
+    if (store_.dirty() || state_dirty_ || rearm_ != 0) return 0;
+#ifdef USE_HYDRO_REST_API
+    if (!stream_.empty()) return 0;
+#endif
+#ifdef USE_HYDRO_WS
+    if (!ws_.empty()) return 0;
+#endif
+    // Сон в loop() останавливает весь узел: интервалы Wi-Fi, API и сенсоров тоже должны
+    // сработать вовремя. Слишком короткий бюджет отсекает PowerSave::idle()
+    const optional<uint32_t> next = App.scheduler.next_schedule_in(now);
+    if (!next.has_value()) return 0;
+    uint32_t budget = *next;
+    if (!deadlines_.empty()) {
+      const int32_t left = (int32_t) (deadlines_.next_deadline() - now);
+      budget = std::min(budget, left > 0 ? (uint32_t) left : 0);
+    }
+    return budget;
+  }
+
+  // Во сне LEDC не тактуется: удержать можно только выход на 0 или 100 %
+  bool outputs_steady_() const {
+    for (uint8_t ch = 0; ch < pumps_.sched.count; ch++) {
+      auto *pump = pumps_.fan[ch];
+      if (pump->state && pump->speed < pump->get_traits().supported_speed_count()) return false;
+    }
+    for (uint8_t ch = 0; ch < lights_.sched.count; ch++) {
+      auto *light = lights_.light[ch];
+      if (light->is_transformer_active()) return false;
+      const auto &v = light->current_values;
+      if (v.is_on() && v.get_brightness() < 1.0f) return false;
+    }
+    return true;
+  }
+#endif
 
-  fan::Fan *pump_{nullptr};
-  light::LightState *light_{nullptr};
+  uint8_t series_count_() const { return SERIES_FIRST_SENSOR + history_sensor_count_; }
+  const char *series_name_(uint8_t series) const {
+    if (series == SERIES_PUMP) return "pump";
+    if (series == SERIES_LIGHT) return "light";
+    return sensor_names_[series - SERIES_FIRST_SENSOR];
+  }
+  // -1 — нет такого ряда
+  int series_index_(const char *name) const {
+    for (uint8_t i = 0; i < series_count_(); i++) {
+      if (strcmp(series_name_(i), name) == 0) return i;
+    }
+    return -1;
+  }
+
+  void publish_state_() {
+    state_dirty_ = false;
+    const StateSnapshot s = snapshot_();
+    record_actuators_(s);
+#ifdef USE_HYDRO_WS
+    ws_.publish(s);
+#endif
+#ifdef USE_HYDRO_REST_API
+    if (stream_.empty()) return;
+    char buf[STATE_JSON_SIZE];
+    const uint8_t changed = s.diff(published_);
+    published_ = s;
+    if (changed != 0) stream_.broadcast(buf, s.to_json(buf, sizeof(buf), changed));
+    if (stream_.has_fresh()) stream_.send_full(buf, s.to_json(buf, sizeof(buf), FIELD_ALL));
+#endif
+  }
+
+  PumpChannels pumps_;
+  LightChannels lights_;
   time::RealTimeClock *clock_{nullptr};
+#ifdef USE_HYDRO_REST_API
   web_server::WebServer *server_{nullptr};
+#endif
 
-  bool enabled_{false};
-  bool running_on_{false};
-  uint32_t last_change_ms_{0};
-  int on_minutes_{5};
-  int off_minutes_{15};
-  
-  bool light_sched_enabled_{false};
-  int light_on_minutes_{1080};   // 18:00
-  int light_off_minutes_{540};   // 09:00
-  
-  ESPPreferenceObject pref_;
+  DeadlineQueue<MAX_RULES> deadlines_;
+  std::atomic<uint16_t> rearm_{0};
+
+  SettingsStore<PackedSettings> store_;
+
+#ifdef USE_HYDRO_REST_API
+  StateStream stream_;
+  StateSnapshot published_;
+#endif
+#ifdef USE_HYDRO_WS
+  WsServer ws_;
+#endif
+  Metrics metrics_;
+  std::atomic<bool> state_dirty_{false};
+  EventLog<EVENT_LOG_SIZE> events_;
+
+  HistoryStore history_;
+  uint32_t history_size_{0};
+  uint32_t history_interval_ms_{300000};
+  sensor::Sensor *history_sensors_[MAX_HISTORY_SENSORS]{};
+  char sensor_names_[MAX_HISTORY_SENSORS][32]{};
+  uint8_t history_sensor_count_{0};
+  int16_t recorded_pump_{-1};  // -1 — ещё не записано
+  int16_t recorded_light_{-1};
+
+#ifdef USE_HYDRO_ANALOG
+  AnalogSampler analog_;
+  int analog_pins_[ANALOG_CHANNELS]{35, 34};
+  uint32_t analog_interval_ms_{10000};
+  sensor::Sensor *ph_sensor_{nullptr};
+  sensor::Sensor *ec_sensor_{nullptr};
+  sensor::Sensor *water_temp_{nullptr};
+  int32_t ph_neutral_mv_{1500};
+  int32_t ph_acid_mv_{2032};
+  int32_t ec_k_milli_{1000};
+#endif
+
+#ifdef USE_HYDRO_POWER_SAVE
+  PowerSave power_;
+#endif
 
   friend class Handler;
 };
 
+#ifdef USE_HYDRO_REST_API
 // Web Handler
 class Handler : public AsyncWebHandler {
  public:
   Handler(HydroponicController *owner) : owner_(owner) {}
   
-  bool canHandle(AsyncWebServerRequest *req) const override {
-    auto url = req->url();
-    return url == "/" || url == "/pump-cycle" || url == "/api/state" || 
-           url == "/api/pump" || url == "/api/pump-cycle" || 
-           url == "/api/light" || url == "/api/light-schedule";
-  }
+  bool canHandle(AsyncWebServerRequest *req) const override { return route_of_(req) != ROUTE_NONE; }
   
   void handleRequest(AsyncWebServerRequest *req) override;
 
  protected:
+  // Маршрут по пути без query-строки: switch по FNV-хэшу, затем одна проверка строки
+  static Route route_of_(AsyncWebServerRequest *req) {
+    const char *uri = static_cast<httpd_req_t *>(*req)->uri;
+    const size_t len = strcspn(uri, "?");
+    switch (path_hash(uri, len)) {
+#ifdef USE_HYDRO_WEB_UI
+      case path_hash("/"):
+        return path_is(uri, len, "/") ? ROUTE_INDEX : ROUTE_NONE;
+      case path_hash("/pump-cycle"):
+        return path_is(uri, len, "/pump-cycle") ? ROUTE_INDEX : ROUTE_NONE;
+#endif
+      case path_hash("/api/state"):
+        return path_is(uri, len, "/api/state") ? ROUTE_STATE : ROUTE_NONE;
+      case path_hash("/api/pump"):
+        return path_is(uri, len, "/api/pump") ? ROUTE_PUMP : ROUTE_NONE;
+#ifdef USE_HYDRO_PUMP_SCHEDULE
+      case path_hash("/api/pump-cycle"):
+        return path_is(uri, len, "/api/pump-cycle") ? ROUTE_PUMP_CYCLE : ROUTE_NONE;
+#endif
+      case path_hash("/api/light"):
+        return path_is(uri, len, "/api/light") ? ROUTE_LIGHT : ROUTE_NONE;
+#ifdef USE_HYDRO_LIGHT_SCHEDULE
+      case path_hash("/api/light-schedule"):
+        return path_is(uri, len, "/api/light-schedule") ? ROUTE_LIGHT_SCHEDULE : ROUTE_NONE;
+#endif
+      case path_hash("/api/batch"):
+        return path_is(uri, len, "/api/batch") ? ROUTE_BATCH : ROUTE_NONE;
+      case path_hash("/api/events"):
+        return path_is(uri, len, "/api/events") ? ROUTE_EVENTS : ROUTE_NONE;
+      case path_hash("/api/events/stream"):
+        return path_is(uri, len, "/api/events/stream") ? ROUTE_EVENTS_STREAM : ROUTE_NONE;
+      case path_hash("/api/metrics"):
+        return path_is(uri, len, "/api/metrics") ? ROUTE_METRICS : ROUTE_NONE;
+      case path_hash("/api/history"):
+        return path_is(uri, len, "/api/history") ? ROUTE_HISTORY : ROUTE_NONE;
+      default:
+        return ROUTE_NONE;
+    }
+  }
+
+  // Обработчики возвращают число отправленных байт тела ответа
+  size_t dispatch_(AsyncWebServerRequest *req, Route route);
+#ifdef USE_HYDRO_WEB_UI
+  size_t send_index_(AsyncWebServerRequest *req) const;
+#endif
+  size_t send_metrics_(AsyncWebServerRequest *req) const;
+  size_t send_events_(AsyncWebServerRequest *req) const;
+  size_t send_history_(AsyncWebServerRequest *req) const;
+  size_t handle_batch_(AsyncWebServerRequest *req);
+  // Канал выбирается параметром ch (по умолчанию 0)
+  size_t apply_command_(AsyncWebServerRequest *req, Command &cmd) {
+    if (req->hasParam("ch")) {
+      const int ch = atoi(req->getParam("ch")->value().c_str());
+      cmd.set(CMD_CHANNEL, ch >= 0 && ch < MAX_CHANNELS ? ch : MAX_CHANNELS);
+    }
+    if (!owner_->apply_(cmd)) return reply_(req, 400, "{\"error\":\"unknown channel\"}");
+    return reply_(req, 200, "{\"ok\":true}");
+  }
+  static size_t reply_(AsyncWebServerRequest *req, int code, const char *content) {
+    req->send(code, "application/json", content);
+    return strlen(content);
+  }
+
   HydroponicController *owner_;
 };
 
@@ -237,233 +772,387 @@ inline void HydroponicController::register_routes_() {
   web_server_base::global_web_server_base->add_handler(handler);
   ESP_LOGD(TAG, "Web routes registered");
 }
+#endif  // USE_HYDRO_REST_API
+
+// Единая точка применения команд API: одно действие на устройство,
+// один перевзвод расписания и одна пометка настроек на команду
+inline bool HydroponicController::apply_(const Command &cmd) {
+  const uint8_t ch = cmd.channel();
+  if ((cmd.touches_pump() && ch >= pumps_.sched.count) || (cmd.touches_light() && ch >= lights_.sched.count))
+    return false;
+  for (uint8_t f = 0; f < CMD_CHANNEL; f++) {
+    if (cmd.has(static_cast<CommandField>(f))) log_event_(EVENT_COMMAND, ch, f, cmd.get(static_cast<CommandField>(f)));
+  }
+  if (cmd.has(CMD_PUMP_ON) || cmd.has(CMD_PUMP_SPEED)) {
+    auto call = pumps_.fan[ch]->make_call();
+    if (cmd.has(CMD_PUMP_ON)) call.set_state(cmd.get(CMD_PUMP_ON) != 0);
+    if (cmd.has(CMD_PUMP_SPEED)) call.set_speed(cmd.get(CMD_PUMP_SPEED));
+    call.perform();
+  }
+  if (cmd.has(CMD_LIGHT_ON) || cmd.has(CMD_LIGHT_BRIGHTNESS)) {
+    auto call = lights_.light[ch]->make_call();
+    if (cmd.has(CMD_LIGHT_ON)) call.set_state(cmd.get(CMD_LIGHT_ON) != 0);
+    if (cmd.has(CMD_LIGHT_BRIGHTNESS)) call.set_brightness(cmd.get(CMD_LIGHT_BRIGHTNESS) / 100.0f);
+    call.perform();
+  }
+
+  // Поля выключенного при сборке расписания игнорируются
+  bool pump_sched = false, light_sched = false;
+#ifdef USE_HYDRO_PUMP_SCHEDULE
+  auto &pumps = pumps_.sched;
+  if (cmd.has(CMD_PUMP_SCHED_ON)) pumps.on_minutes[ch] = cmd.get(CMD_PUMP_SCHED_ON);
+  if (cmd.has(CMD_PUMP_SCHED_OFF)) pumps.off_minutes[ch] = cmd.get(CMD_PUMP_SCHED_OFF);
+  if (cmd.has(CMD_PUMP_SCHED_ENABLED)) {
+    pumps.enabled[ch] = cmd.get(CMD_PUMP_SCHED_ENABLED) != 0;
+    if (pumps.enabled[ch]) start_cycle_(ch);
+    else stop_cycle_(ch);
+  }
+  pump_sched = cmd.touches_pump_schedule();
+  if (pump_sched) request_rearm_(RULE_PUMP + ch);
+#endif
+#ifdef USE_HYDRO_LIGHT_SCHEDULE
+  auto &lights = lights_.sched;
+  if (cmd.has(CMD_LIGHT_SCHED_ENABLED)) lights.enabled[ch] = cmd.get(CMD_LIGHT_SCHED_ENABLED) != 0;
+  if (cmd.has(CMD_LIGHT_SCHED_ON)) lights.on_minutes[ch] = cmd.get(CMD_LIGHT_SCHED_ON);
+  if (cmd.has(CMD_LIGHT_SCHED_OFF)) lights.off_minutes[ch] = cmd.get(CMD_LIGHT_SCHED_OFF);
+  light_sched = cmd.touches_light_schedule();
+  if (light_sched) request_rearm_(RULE_LIGHT + ch);
+#endif
+  if (pump_sched || light_sched) {
+    save_settings_();
+    notify_state_();
+  }
+  return true;
+}
+
+#ifdef USE_HYDRO_REST_API
+#ifdef USE_HYDRO_WEB_UI
+// Страница отдаётся прямо из flash без копирования; браузер ревалидирует её по ETag
+inline size_t Handler::send_index_(AsyncWebServerRequest *req) const {
+  httpd_req_t *r = *req;
+  char etag[40];
+  if (httpd_req_get_hdr_value_str(r, "If-None-Match", etag, sizeof(etag)) == ESP_OK &&
+      strcmp(etag, HYDROPONIC_INDEX_ETAG) == 0) {
+    httpd_resp_set_status(r, "304 Not Modified");
+    httpd_resp_set_hdr(r, "ETag", HYDROPONIC_INDEX_ETAG);
+    httpd_resp_send(r, nullptr, 0);
+    return 0;
+  }
+  httpd_resp_set_type(r, "text/html");
+  httpd_resp_set_hdr(r, "Content-Encoding", "gzip");
+  httpd_resp_set_hdr(r, "Cache-Control", "no-cache");
+  httpd_resp_set_hdr(r, "ETag", HYDROPONIC_INDEX_ETAG);
+  httpd_resp_send(r, reinterpret_cast<const char *>(HYDROPONIC_INDEX_HTML), HYDROPONIC_INDEX_HTML_SIZE);
+  return HYDROPONIC_INDEX_HTML_SIZE;
+}
+#endif
+
+// Prometheus text format, формируется кусками в буфере на стеке
+inline size_t Handler::send_metrics_(AsyncWebServerRequest *req) const {
+  httpd_req_t *r = *req;
+  httpd_resp_set_type(r, "text/plain; version=0.0.4");
+  httpd_resp_set_hdr(r, "Cache-Control", "no-cache");
+  ChunkedWriter w(r);
+  owner_->metrics_.write(w);
+  const auto &store = owner_->store_;
+  w.printf("# HELP hydro_nvs_writes_total Settings writes committed to flash.\n"
+           "# TYPE hydro_nvs_writes_total counter\n"
+           "hydro_nvs_writes_total %u\n"
+           "# HELP hydro_nvs_skipped_total Settings writes skipped because the CRC was unchanged.\n"
+           "# TYPE hydro_nvs_skipped_total counter\n"
+           "hydro_nvs_skipped_total %u\n"
+           "# HELP hydro_nvs_failures_total Failed settings writes.\n"
+           "# TYPE hydro_nvs_failures_total counter\n"
+           "hydro_nvs_failures_total %u\n",
+           (unsigned) store.writes(), (unsigned) store.skipped(), (unsigned) store.failures());
+  w.printf("# HELP hydro_stream_clients Connected /api/events/stream subscribers.\n"
+           "# TYPE hydro_stream_clients gauge\n"
+           "hydro_stream_clients %u\n",
+           (unsigned) owner_->stream_.size());
+  w.printf("# HELP hydro_events_total Events recorded in the /api/events log.\n"
+           "# TYPE hydro_events_total counter\n"
+           "hydro_events_total %u\n",
+           (unsigned) owner_->events_.last());
+#ifdef USE_HYDRO_WS
+  const auto &ws = owner_->ws_;
+  w.printf("# HELP hydro_ws_clients Connected WebSocket clients.\n"
+           "# TYPE hydro_ws_clients gauge\n"
+           "hydro_ws_clients %u\n"
+           "# HELP hydro_ws_rejected_total WebSocket connections refused at the client limit.\n"
+           "# TYPE hydro_ws_rejected_total counter\n"
+           "hydro_ws_rejected_total %u\n",
+           (unsigned) ws.size(), (unsigned) ws.rejected());
+  w.printf("# HELP hydro_ws_frames_total WebSocket frames received and state frames sent.\n"
+           "# TYPE hydro_ws_frames_total counter\n"
+           "hydro_ws_frames_total{dir=\"in\"} %u\n"
+           "hydro_ws_frames_total{dir=\"out\"} %u\n"
+           "# HELP hydro_ws_sent_bytes_total State frame payload bytes sent over WebSocket.\n"
+           "# TYPE hydro_ws_sent_bytes_total counter\n"
+           "hydro_ws_sent_bytes_total %u\n",
+           (unsigned) ws.frames_in(), (unsigned) ws.frames_out(), (unsigned) ws.bytes_out());
+#endif
+#ifdef USE_HYDRO_POWER_SAVE
+  const auto &power = owner_->power_;
+  w.printf("# HELP hydro_sleep_ratio Fraction of uptime spent in light sleep.\n"
+           "# TYPE hydro_sleep_ratio gauge\n"
+           "hydro_sleep_ratio %u.%03u\n"
+           "# HELP hydro_sleep_seconds_total Time spent in light sleep.\n"
+           "# TYPE hydro_sleep_seconds_total counter\n"
+           "hydro_sleep_seconds_total %u.%03u\n",
+           (unsigned) (power.sleep_permille() / 1000), (unsigned) (power.sleep_permille() % 1000),
+           (unsigned) (power.slept_us() / 1000000), (unsigned) (power.slept_us() / 1000 % 1000));
+  w.printf("# HELP hydro_sleeps_total Light sleep entries.\n"
+           "# TYPE hydro_sleeps_total counter\n"
+           "hydro_sleeps_total %u\n"
+           "# HELP hydro_sleep_early_wakeups_total Light sleeps ended by something other than the timer.\n"
+           "# TYPE hydro_sleep_early_wakeups_total counter\n"
+           "hydro_sleep_early_wakeups_total %u\n",
+           (unsigned) power.sleeps(), (unsigned) power.early_wakeups());
+  w.printf("# HELP hydro_sleep_blocked_by_pwm_total Sleep skipped because a PWM output was between 0 and 100%%.\n"
+           "# TYPE hydro_sleep_blocked_by_pwm_total counter\n"
+           "hydro_sleep_blocked_by_pwm_total %u\n",
+           (unsigned) power.blocked_by_pwm());
+#endif
+  return w.finish();
+}
+
+// /api/events?since=<seq>: события с номером больше since, по порядку.
+// seq в ответе — курсор для следующего запроса; missed — сколько событий после since
+// уже вытеснено из кольца. since больше последнего номера означает перезагрузку
+// устройства: тогда отдаётся всё кольцо. t — millis() события, uptime — millis() ответа.
+inline size_t Handler::send_events_(AsyncWebServerRequest *req) const {
+  const auto &events = owner_->events_;
+  uint32_t since = 0;
+  if (req->hasParam("since")) since = strtoul(req->getParam("since")->value().c_str(), nullptr, 10);
+  const uint32_t last = events.last();
+  if (since > last) since = 0;
+  uint32_t seq = since + 1, missed = 0;
+  if (seq < events.oldest()) {
+    missed = events.oldest() - seq;
+    seq = events.oldest();
+  }
 
-inline std::string HydroponicController::build_index_() const {
-  return std::string(
-    "<!doctype html><html><head><meta charset='utf-8'><meta name='viewport' content='width=device-width,initial-scale=1'>"
-    "<title>Hydroponic Tower</title>"
-    "<style>"
-    ":root{--bg:#0f1115;--fg:#e7e7e7;--card:#171a21;--accent:#4da3ff}"
-    "body{font-family:system-ui,Segoe UI,Roboto,Arial;background:var(--bg);color:var(--fg);margin:0;padding:16px}"
-    "h1{margin:0 0 16px 0;font-size:22px}"
-    ".grid{display:grid;grid-template-columns:repeat(auto-fit,minmax(300px,1fr));gap:16px}"
-    ".card{background:var(--card);border-radius:10px;padding:16px;box-shadow:0 2px 8px rgba(0,0,0,.3)}"
-    ".row{display:flex;align-items:center;gap:10px;margin:10px 0}"
-    ".switch{position:relative;display:inline-block;width:48px;height:26px}"
-    ".switch input{display:none}"
-    ".slider{position:absolute;cursor:pointer;top:0;left:0;right:0;bottom:0;background:#3a4252;border-radius:26px;transition:.2s}"
-    ".slider:before{position:absolute;content:'';height:22px;width:22px;left:2px;top:2px;background:#fff;border-radius:50%;transition:.2s}"
-    "input:checked+.slider{background:var(--accent)}"
-    "input:checked+.slider:before{transform:translateX(22px)}"
-    "input[type=number],input[type=time]{background:#0c0e13;color:var(--fg);border:1px solid #2a2f3a;border-radius:6px;padding:6px 8px}"
-    "input[type=range],progress{width:200px}"
-    "progress{height:8px;border-radius:4px;background:#2a2f3a}"
-    "progress::-webkit-progress-bar{background:#2a2f3a;border-radius:4px}"
-    "progress::-webkit-progress-value{background:var(--accent);border-radius:4px}"
-    "input[type=file]{font-size:14px;color:var(--fg)}"
-    "button{background:var(--accent);color:#001c38;border:0;border-radius:6px;padding:8px 12px;cursor:pointer;font-weight:500}"
-    "button:hover{opacity:0.9}"
-    "#log{background:#0c0e13;border:1px solid #2a2f3a;border-radius:8px;padding:8px;height:280px;overflow:auto;white-space:pre-wrap}"
-    "small.mono{font-family:ui-monospace,monospace;color:#9aa4b2}"
-    ".build{position:absolute;top:20px;right:20px;font-size:11px;color:#666}"
-    "</style></head><body>"
-    "<h1>Hydroponic Tower</h1>"
-    "<div class='grid'>"
-    "  <div class='card'>"
-    "    <h3>Pump</h3>"
-    "    <div class='row'><label class='switch'><input id='pump_on' type='checkbox'><span class='slider'></span></label><span>Pump ON</span></div>"
-    "    <div class='row'><span>Speed</span> <input id='pump_speed' type='range' min='0' max='100'><span id='pump_speed_v'>0%</span></div>"
-    "    <div class='row'><label class='switch'><input id='pump_sched_en' type='checkbox'><span class='slider'></span></label><span>Schedule</span></div>"
-    "    <div class='row'><label>ON, min <input id='pump_on_min' type='number' min='1' max='120' style='width:90px'></label>"
-    "         <label>OFF, min <input id='pump_off_min' type='number' min='1' max='120' style='width:90px'></label>"
-    "         <button id='pump_save'>Save</button><small id='pump_status' class='mono'></small></div>"
-    "  </div>"
-    "  <div class='card'>"
-    "    <h3>Lighting</h3>"
-    "    <div class='row'><label class='switch'><input id='light_on' type='checkbox'><span class='slider'></span></label><span>Light ON</span></div>"
-    "    <div class='row'><span>Brightness</span> <input id='light_bri' type='range' min='0' max='100'><span id='light_bri_v'>0%</span></div>"
-    "    <div class='row'><label class='switch'><input id='light_sched_en' type='checkbox'><span class='slider'></span></label><span>Schedule</span></div>"
-    "    <div class='row'><label>ON <input id='light_on_time' type='time' value='18:00'></label>"
-    "         <label>OFF <input id='light_off_time' type='time' value='09:00'></label>"
-    "         <button id='light_save'>Save</button><small id='light_status' class='mono'></small></div>"
-    "  </div>"
-    "</div>"
-    "<div class='card' style='margin-top:16px'>"
-    "  <h3>Firmware Update</h3>"
-    "  <div class='row'><input type='file' id='ota_file' accept='.bin'><button id='ota_btn'>Upload</button></div>"
-    "  <div class='row'><progress id='ota_progress' style='width:100%;display:none'></progress></div>"
-    "  <div class='row'><small id='ota_status' class='mono'></small></div>"
-    "</div>"
-    "<h3 style='margin:16px 0 8px'>Events</h3>"
-    "<div id='log'></div>"
-    "<script>"
-    "let prev=null,ignoreNext={}; function t(){return new Date().toLocaleTimeString()}"
-    "function toMin(hm){const[a,b]=hm.split(':');return (+a)*60+(+b)}"
-    "function toHM(m){m=(m+1440)%1440;const h=('0'+Math.floor(m/60)).slice(-2);const mi=('0'+(m%60)).slice(-2);return h+':'+mi}"
-    "function log(msg){const el=document.getElementById('log'); el.textContent+='['+t()+'] '+msg+'\\n'; el.scrollTop=el.scrollHeight}"
-    "async function load(){try{const s=await fetch('/api/state').then(r=>r.json()); apply(s,true); prev=s; log('State loaded');}catch(e){log('Load error: '+e.message)}}"
-    "function apply(j,full){pump_on.checked=j.pump_on; pump_speed.value=j.pump_speed; pump_speed_v.textContent=j.pump_speed+'%';"
-    "if(full){pump_sched_en.checked=j.pump_sched.enabled; pump_on_min.value=j.pump_sched.on; pump_off_min.value=j.pump_sched.off;}"
-    "light_on.checked=j.light_on; light_bri.value=j.light_brightness; light_bri_v.textContent=j.light_brightness+'%';"
-    "if(full){light_sched_en.checked=j.light_sched.enabled; light_on_time.value=toHM(j.light_sched.on); light_off_time.value=toHM(j.light_sched.off);}}"
-    "async function post(u){const r=await fetch(u,{method:'POST'}); if(!r.ok) throw new Error('HTTP');}"
-    "pump_on.onchange=async()=>{try{await post('/api/pump?on='+(pump_on.checked?1:0));log('Pump '+(pump_on.checked?'ON':'OFF'));ignoreNext.pump_on=true;}catch(e){log('Pump toggle error')}};"
-    "pump_speed.oninput=()=>{pump_speed_v.textContent=pump_speed.value+'%'};"
-    "pump_speed.onchange=async()=>{try{await post('/api/pump?speed='+pump_speed.value);log('Pump speed '+pump_speed.value+'%');ignoreNext.pump_speed=true;}catch(e){log('Pump speed error')}};"
-    "pump_sched_en.onchange=async()=>{try{const p=new URLSearchParams({enabled:pump_sched_en.checked?1:0,on:pump_on_min.value,off:pump_off_min.value});await post('/api/pump-cycle?'+p.toString());log('Pump schedule '+(pump_sched_en.checked?'enabled':'disabled'));}catch(e){log('Pump schedule toggle error');pump_sched_en.checked=!pump_sched_en.checked}};"
-    "document.getElementById('pump_save').onclick=async()=>{const p=new URLSearchParams({enabled:pump_sched_en.checked?1:0,on:pump_on_min.value,off:pump_off_min.value});"
-    " try{await post('/api/pump-cycle?'+p.toString());pump_status.textContent='Saved';setTimeout(()=>pump_status.textContent='',1200);log('Pump schedule times saved');}catch(e){pump_status.textContent='Error';log('Pump save error')}};"
-    "light_on.onchange=async()=>{try{await post('/api/light?on='+(light_on.checked?1:0));log('Light '+(light_on.checked?'ON':'OFF'));ignoreNext.light_on=true;}catch(e){log('Light toggle error')}};"
-    "light_bri.oninput=()=>{light_bri_v.textContent=light_bri.value+'%'};"
-    "light_bri.onchange=async()=>{try{await post('/api/light?brightness='+light_bri.value);log('Light brightness '+light_bri.value+'%');ignoreNext.light_bri=true;}catch(e){log('Light brightness error')}};"
-    "light_sched_en.onchange=async()=>{try{const on=toMin(light_on_time.value),off=toMin(light_off_time.value);const p=new URLSearchParams({enabled:light_sched_en.checked?1:0,on:on,off:off});await post('/api/light-schedule?'+p.toString());log('Light schedule '+(light_sched_en.checked?'enabled':'disabled'));}catch(e){log('Light schedule toggle error');light_sched_en.checked=!light_sched_en.checked}};"
-    "document.getElementById('light_save').onclick=async()=>{const on=toMin(light_on_time.value),off=toMin(light_off_time.value);const p=new URLSearchParams({enabled:light_sched_en.checked?1:0,on:on,off:off});"
-    " try{await post('/api/light-schedule?'+p.toString());light_status.textContent='Saved';setTimeout(()=>light_status.textContent='',1200);log('Light schedule times saved');}catch(e){light_status.textContent='Error';log('Light save error')}};"
-    "document.getElementById('ota_btn').onclick=async()=>{"
-    " const file=ota_file.files[0]; if(!file){ota_status.textContent='Select file first';return;}"
-    " const formData=new FormData(); formData.append('file',file);"
-    " ota_status.textContent='Uploading...'; ota_progress.style.display='block'; ota_progress.value=0;"
-    " try{"
-    "  const xhr=new XMLHttpRequest();"
-    "  xhr.upload.onprogress=e=>{if(e.lengthComputable)ota_progress.value=(e.loaded/e.total)*100;};"
-    "  xhr.onload=()=>{if(xhr.status===200){ota_status.textContent='✓ Success! Rebooting...';log('Firmware uploaded, rebooting...');}else{ota_status.textContent='✗ Upload failed';}};"
-    "  xhr.onerror=()=>{ota_status.textContent='✗ Network error';};"
-    "  xhr.open('POST','/update'); xhr.send(formData);"
-    " }catch(e){ota_status.textContent='✗ Error: '+e.message;}"
-    "};"
-    "setInterval(async()=>{try{const s=await fetch('/api/state').then(r=>r.json()); if(prev){if(prev.pump_on!==s.pump_on && !ignoreNext.pump_on) log('Pump '+(s.pump_on?'ON':'OFF')); if(prev.pump_speed!==s.pump_speed && !ignoreNext.pump_speed) log('Pump speed '+s.pump_speed+'%'); if(prev.light_on!==s.light_on && !ignoreNext.light_on) log('Light '+(s.light_on?'ON':'OFF')); if(prev.light_brightness!==s.light_brightness && !ignoreNext.light_bri) log('Light brightness '+s.light_brightness+'%');} ignoreNext={}; prev=s; apply(s,false);}catch(e){log('Poll error')}} ,2000);"
-    "log('UI loaded'); load();"
-    "</script>"
-    "</body></html>");
+  httpd_req_t *r = *req;
+  httpd_resp_set_type(r, "application/json");
+  httpd_resp_set_hdr(r, "Cache-Control", "no-cache");
+  ChunkedWriter w(r);
+  w.write("{\"events\":[", 11);
+  Event e;
+  const char *sep = "";
+  for (; seq <= last; seq++) {
+    if (!events.read(seq, &e)) {
+      // Перезаписано, пока читали, — пропуск; ещё пишется — следующий запрос начнёт с него
+      if (seq < events.oldest()) {
+        missed++;
+        continue;
+      }
+      break;
+    }
+    w.printf("%s{\"seq\":%u,\"t\":%u,\"type\":\"%s\",\"ch\":%u", sep, (unsigned) e.seq, (unsigned) e.ms,
+             EVENT_TYPE_NAMES[e.type], e.channel);
+    sep = ",";
+    if (e.type == EVENT_COMMAND) w.printf(",\"field\":\"%s\"", COMMAND_FIELDS[e.field].key);
+    w.printf(",\"value\":%d}", (int) e.value);
+  }
+  w.printf("],\"seq\":%u,\"missed\":%u,\"uptime\":%u}", (unsigned) (seq - 1), (unsigned) missed,
+           (unsigned) millis());
+  return w.finish();
+}
+
+// /api/history?from=&to=&series=&format=bin|json&step=
+// Блоки копируются из хранилища по одному на стек и сразу отправляются чанками:
+// format=bin — блоки как есть, json — {"<ряд>":[[ts,value],...]}, при step > 0
+// значения усредняются по интервалам step секунд (метка — начало интервала).
+inline size_t Handler::send_history_(AsyncWebServerRequest *req) const {
+  auto &history = owner_->history_;
+  if (!history.enabled()) return reply_(req, 404, "{\"error\":\"history disabled\"}");
+  uint32_t from = 0, to = UINT32_MAX, step = 0;
+  if (req->hasParam("from")) from = strtoul(req->getParam("from")->value().c_str(), nullptr, 10);
+  if (req->hasParam("to")) to = strtoul(req->getParam("to")->value().c_str(), nullptr, 10);
+  if (req->hasParam("step")) step = strtoul(req->getParam("step")->value().c_str(), nullptr, 10);
+  uint8_t first = 0, last = owner_->series_count_();
+  if (req->hasParam("series")) {
+    const int series = owner_->series_index_(req->getParam("series")->value().c_str());
+    if (series < 0) return reply_(req, 400, "{\"error\":\"unknown series\"}");
+    first = series;
+    last = series + 1;
+  }
+  const bool binary = req->hasParam("format") && req->getParam("format")->value() == "bin";
+
+  httpd_req_t *r = *req;
+  httpd_resp_set_type(r, binary ? "application/octet-stream" : "application/json");
+  httpd_resp_set_hdr(r, "Cache-Control", "no-cache");
+  ChunkedWriter w(r);
+  HistoryBlock block;
+  if (!binary) w.write("{", 1);
+  for (uint8_t s = first; s < last; s++) {
+    if (!binary) w.printf("%s\"%s\":[", s != first ? "," : "", owner_->series_name_(s));
+    const char *sep = "";
+    auto emit = [&](uint32_t ts, float v) {
+      w.printf("%s[%u,%g]", sep, (unsigned) ts, v);
+      sep = ",";
+    };
+    uint32_t bucket = 0, n = 0;
+    float sum = 0;
+    HistoryStore::Cursor cursor;
+    while (history.copy_next(s, &cursor, from, to, &block)) {
+      if (binary) {
+        w.write(reinterpret_cast<const char *>(&block), block.h.used);
+        continue;
+      }
+      HistoryBlockReader reader(block);
+      uint32_t ts;
+      float v;
+      while (reader.next(&ts, &v)) {
+        if (ts < from || ts > to) continue;
+        if (step == 0) {
+          emit(ts, v);
+          continue;
+        }
+        const uint32_t start = ts - ts % step;
+        if (n > 0 && start != bucket) {
+          emit(bucket, sum / n);
+          n = 0;
+          sum = 0;
+        }
+        bucket = start;
+        sum += v;
+        n++;
+      }
+    }
+    if (n > 0) emit(bucket, sum / n);
+    if (!binary) w.write("]", 1);
+  }
+  if (!binary) w.write("}", 1);
+  return w.finish();
 }
 
 inline void Handler::handleRequest(AsyncWebServerRequest *req) {
+  const uint32_t start = micros();
+  auto &metrics = owner_->metrics_;
+  metrics.sample_heap();
+#ifdef USE_HYDRO_POWER_SAVE
+  owner_->power_.note_activity();
+#endif
+  const Route route = route_of_(req);
+  const size_t bytes = dispatch_(req, route);
+  metrics.sample_heap();
+  metrics.record_request(route, micros() - start, bytes);
+}
+
+inline size_t Handler::dispatch_(AsyncWebServerRequest *req, Route route) {
   using namespace web_server_idf;
-  auto url = req->url();
   
+#ifdef USE_HYDRO_WEB_UI
   // Root page
-  if (url == "/" || url == "/pump-cycle") {
-    std::string html = owner_->build_index_();
-    req->send(200, "text/html", html.c_str());
-    return;
+  if (route == ROUTE_INDEX) {
+    return send_index_(req);
   }
+#endif
   
   // State API
-  if (url == "/api/state") {
-    int pump_speed = 0;
-    bool pump_on = false;
-    if (owner_->pump_ != nullptr) {
-      pump_on = owner_->pump_->state;
-      pump_speed = owner_->pump_->speed;
-    }
-    
-    int light_brightness = 0;
-    bool light_on = false;
-    if (owner_->light_ != nullptr) {
-      light_on = owner_->light_->current_values.is_on();
-      light_brightness = (int)(owner_->light_->current_values.get_brightness() * 100.0f + 0.5f);
+  if (route == ROUTE_STATE) {
+    char buf[STATE_JSON_SIZE];
+    owner_->snapshot_().to_json(buf, sizeof(buf), FIELD_ALL);
+    return reply_(req, 200, buf);
+  }
+  
+  // Журнал событий после курсора since
+  if (route == ROUTE_EVENTS) {
+    return send_events_(req);
+  }
+  
+  // Server-Sent Events: полный снимок при подключении, дальше только изменённые поля
+  if (route == ROUTE_EVENTS_STREAM) {
+    if (!owner_->stream_.subscribe(req)) {
+      ESP_LOGW(TAG, "State stream rejected: subscriber limit reached");
+      return reply_(req, 503, "{\"error\":\"too many subscribers\"}");
     }
-    
-    char buf[256];
-    snprintf(buf, sizeof(buf),
-      "{\"pump_on\":%s,\"pump_speed\":%d,\"pump_sched\":{\"enabled\":%s,\"on\":%d,\"off\":%d},\"light_on\":%s,\"light_brightness\":%d,\"light_sched\":{\"enabled\":%s,\"on\":%d,\"off\":%d}}",
-      pump_on?"true":"false", pump_speed, owner_->enabled_?"true":"false", owner_->on_minutes_, owner_->off_minutes_,
-      light_on?"true":"false", light_brightness, owner_->light_sched_enabled_?"true":"false", owner_->light_on_minutes_, owner_->light_off_minutes_);
-    req->send(200, "application/json", buf);
-    return;
+    ESP_LOGD(TAG, "State stream client connected (%u/%u)", owner_->stream_.size(), owner_->stream_.get_max_clients());
+    return 0;
+  }
+  
+  // Metrics
+  if (route == ROUTE_METRICS) {
+    return send_metrics_(req);
+  }
+  
+  // History
+  if (route == ROUTE_HISTORY) {
+    return send_history_(req);
   }
   
   // Pump control API
-  if (url == "/api/pump" && req->method() == HTTP_POST) {
-    if (req->hasParam("on")) {
-      bool on = req->getParam("on")->value() == "1";
-      if (owner_->pump_ != nullptr) {
-        if (on) owner_->pump_->turn_on().perform(); 
-        else owner_->pump_->turn_off().perform();
-      }
-    }
-    if (req->hasParam("speed")) {
-      int speed = atoi(req->getParam("speed")->value().c_str());
-      if (owner_->pump_ != nullptr) {
-        auto call = owner_->pump_->make_call();
-        call.set_speed(speed);
-        call.perform();
-      }
-    }
-    req->send(200, "application/json", "{\"ok\":true}");
-    return;
+  if (route == ROUTE_PUMP && req->method() == HTTP_POST) {
+    Command cmd;
+    if (req->hasParam("on")) cmd.set(CMD_PUMP_ON, req->getParam("on")->value() == "1");
+    if (req->hasParam("speed")) cmd.set_clamped(CMD_PUMP_SPEED, atoi(req->getParam("speed")->value().c_str()));
+    return apply_command_(req, cmd);
   }
   
+#ifdef USE_HYDRO_PUMP_SCHEDULE
   // Pump schedule API
-  if (url == "/api/pump-cycle" && req->method() == HTTP_POST) {
-    bool changed = false;
-    if (req->hasParam("enabled")) {
-      bool enabled = req->getParam("enabled")->value() == "1";
-      owner_->enabled_ = enabled;
-      if (enabled) owner_->start_cycle_(); 
-      else owner_->stop_cycle_();
-      changed = true;
-    }
-    if (req->hasParam("on")) {
-      owner_->on_minutes_ = std::max(1, std::min(120, atoi(req->getParam("on")->value().c_str())));
-      changed = true;
-    }
-    if (req->hasParam("off")) {
-      owner_->off_minutes_ = std::max(1, std::min(120, atoi(req->getParam("off")->value().c_str())));
-      changed = true;
-    }
-    if (changed) {
-      owner_->save_settings_();
-    }
-    req->send(200, "application/json", "{\"ok\":true}");
-    return;
+  if (route == ROUTE_PUMP_CYCLE && req->method() == HTTP_POST) {
+    Command cmd;
+    if (req->hasParam("enabled")) cmd.set(CMD_PUMP_SCHED_ENABLED, req->getParam("enabled")->value() == "1");
+    if (req->hasParam("on")) cmd.set_clamped(CMD_PUMP_SCHED_ON, atoi(req->getParam("on")->value().c_str()));
+    if (req->hasParam("off")) cmd.set_clamped(CMD_PUMP_SCHED_OFF, atoi(req->getParam("off")->value().c_str()));
+    return apply_command_(req, cmd);
   }
+#endif
   
   // Light control API
-  if (url == "/api/light" && req->method() == HTTP_POST) {
-    if (req->hasParam("on")) {
-      bool on = req->getParam("on")->value() == "1";
-      if (owner_->light_ != nullptr) {
-        if (on) owner_->light_->turn_on().perform();
-        else owner_->light_->turn_off().perform();
-      }
-    }
-    if (req->hasParam("brightness")) {
-      float brightness = atof(req->getParam("brightness")->value().c_str()) / 100.0f;
-      if (owner_->light_ != nullptr) {
-        auto call = owner_->light_->make_call();
-        call.set_brightness(brightness);
-        call.perform();
-      }
-    }
-    req->send(200, "application/json", "{\"ok\":true}");
-    return;
+  if (route == ROUTE_LIGHT && req->method() == HTTP_POST) {
+    Command cmd;
+    if (req->hasParam("on")) cmd.set(CMD_LIGHT_ON, req->getParam("on")->value() == "1");
+    if (req->hasParam("brightness"))
+      cmd.set_clamped(CMD_LIGHT_BRIGHTNESS, atoi(req->getParam("brightness")->value().c_str()));
+    return apply_command_(req, cmd);
   }
   
+#ifdef USE_HYDRO_LIGHT_SCHEDULE
   // Light schedule API
-  if (url == "/api/light-schedule" && req->method() == HTTP_POST) {
-    bool changed = false;
-    if (req->hasParam("enabled")) {
-      owner_->light_sched_enabled_ = req->getParam("enabled")->value() == "1";
-      changed = true;
-    }
-    if (req->hasParam("on")) {
-      owner_->light_on_minutes_ = std::max(0, std::min(1439, atoi(req->getParam("on")->value().c_str())));
-      changed = true;
-    }
-    if (req->hasParam("off")) {
-      owner_->light_off_minutes_ = std::max(0, std::min(1439, atoi(req->getParam("off")->value().c_str())));
-      changed = true;
-    }
-    if (changed) {
-      owner_->save_settings_();
-    }
-    req->send(200, "application/json", "{\"ok\":true}");
-    return;
+  if (route == ROUTE_LIGHT_SCHEDULE && req->method() == HTTP_POST) {
+    Command cmd;
+    if (req->hasParam("enabled")) cmd.set(CMD_LIGHT_SCHED_ENABLED, req->getParam("enabled")->value() == "1");
+    if (req->hasParam("on")) cmd.set_clamped(CMD_LIGHT_SCHED_ON, atoi(req->getParam("on")->value().c_str()));
+    if (req->hasParam("off")) cmd.set_clamped(CMD_LIGHT_SCHED_OFF, atoi(req->getParam("off")->value().c_str()));
+    return apply_command_(req, cmd);
+  }
+#endif
+  
+  // Batch API
+  if (route == ROUTE_BATCH && req->method() == HTTP_POST) {
+    return handle_batch_(req);
   }
   
   req->send(404);
+  return 0;
+}
+
+// Несколько команд за один запрос: параметры формы (тело x-www-form-urlencoded или
+// query) по ключам COMMAND_FIELDS. Тело формы web_server_idf читает до обработчика,
+// поэтому значения берутся через getParam. Всё проверяется до применения, настройки
+// сохраняются одной записью
+inline size_t Handler::handle_batch_(AsyncWebServerRequest *req) {
+  Command cmd;
+  for (uint8_t f = 0; f < CMD_COUNT; f++) {
+    const char *key = COMMAND_FIELDS[f].key;
+    if (!req->hasParam(key)) continue;
+    if (!cmd.parse_value(static_cast<CommandField>(f), req->getParam(key)->value().c_str())) {
+      char err[64];
+      snprintf(err, sizeof(err), "{\"error\":\"invalid\",\"key\":\"%s\"}", key);
+      return reply_(req, 400, err);
+    }
+  }
+  if (!cmd.has_changes()) return reply_(req, 400, "{\"error\":\"no changes\"}");
+  if (!owner_->apply_(cmd)) return reply_(req, 400, "{\"error\":\"unknown channel\"}");
+
+  char buf[STATE_JSON_SIZE];
+  owner_->snapshot_().to_json(buf, sizeof(buf), FIELD_ALL);
+  return reply_(req, 200, buf);
 }
+#endif  // USE_HYDRO_REST_API
 
 }  // namespace hydroponic_controller
 }  // namespace esphome
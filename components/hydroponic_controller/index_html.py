@@ -0,0 +1,44 @@
+"""Сборка веб-интерфейса из index.html; без зависимостей от ESPHome (см. tools/check_index_html.py)."""
+
+import gzip
+import hashlib
+import re
+from pathlib import Path
+
+INDEX_HTML_PATH = Path(__file__).parent / "index.html"
+
+# Блоки index.html между строками "<!--if флаг-->" и "<!--endif-->" попадают в сборку
+# только при включённом флаге; маркеры всегда отдельной строкой
+IF_MARKER = re.compile(r"<!--if (\w+)-->")
+ENDIF_MARKER = "<!--endif-->"
+
+
+def index_flags():
+    """Флаги, упомянутые в маркерах index.html."""
+    return sorted(set(IF_MARKER.findall(INDEX_HTML_PATH.read_text(encoding="utf-8"))))
+
+
+def render_index_html(flags):
+    lines = []
+    stack = []
+    for number, line in enumerate(INDEX_HTML_PATH.read_text(encoding="utf-8").splitlines(), 1):
+        line = line.strip()
+        match = IF_MARKER.fullmatch(line)
+        if match:
+            stack.append(flags[match.group(1)])
+        elif line == ENDIF_MARKER:
+            stack.pop()
+        elif all(stack):
+            # После склейки "//" закомментировал бы весь остальной скрипт
+            if line.startswith("//"):
+                raise ValueError(f"index.html:{number}: line comments break the joined script, use /* */")
+            lines.append(line)
+    # Строки склеиваются без переводов, как раньше в build_index_()
+    return "".join(lines)
+
+
+def compress_index_html(raw):
+    """Сжатая страница и её ETag."""
+    # mtime=0 делает сжатый массив (и ETag) воспроизводимым между сборками
+    data = gzip.compress(raw, compresslevel=9, mtime=0)
+    return data, hashlib.sha1(raw).hexdigest()[:16]
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#ifdef USE_HYDRO_REST_API
+#include "esphome/components/web_server_idf/web_server_idf.h"
+#endif
+#include "routes.h"
+
+#include <esp_heap_caps.h>
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Границы корзин гистограммы: в микросекундах и в виде меток le (секунды)
+static const uint8_t HIST_BUCKETS = 10;
+struct HistogramBounds {
+  uint32_t us[HIST_BUCKETS];
+  const char *le[HIST_BUCKETS];
+};
+
+static const HistogramBounds HTTP_LATENCY_BOUNDS = {
+    {500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000},
+    {"0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5"},
+};
+static const HistogramBounds LOOP_TIME_BOUNDS = {
+    {5, 10, 25, 50, 100, 250, 500, 1000, 5000, 20000},
+    {"0.000005", "0.00001", "0.000025", "0.00005", "0.0001", "0.00025", "0.0005", "0.001", "0.005", "0.02"},
+};
+static const HistogramBounds NVS_FLUSH_BOUNDS = {
+    {1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000},
+    {"0.001", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5"},
+};
+
+struct Histogram {
+  uint32_t buckets[HIST_BUCKETS + 1]{};  // последняя — +Inf
+  uint32_t count{0};
+  uint64_t sum_us{0};
+
+  void record(const HistogramBounds &bounds, uint32_t us) {
+    uint8_t i = 0;
+    while (i < HIST_BUCKETS && us > bounds.us[i]) i++;
+    buckets[i]++;
+    count++;
+    sum_us += us;
+  }
+};
+
+#ifdef USE_HYDRO_REST_API
+// Ответ с Transfer-Encoding: chunked через буфер фиксированного размера
+class ChunkedWriter {
+ public:
+  explicit ChunkedWriter(httpd_req_t *req) : req_(req) {}
+
+  void printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+      va_list args;
+      va_start(args, fmt);
+      const int n = vsnprintf(buf_ + len_, sizeof(buf_) - len_, fmt, args);
+      va_end(args);
+      if (n < 0) return;
+      if (len_ + n < sizeof(buf_)) {
+        len_ += n;
+        return;
+      }
+      // Не влезло: отправить накопленное и повторить с пустым буфером
+      if (len_ == 0) return;
+      flush_();
+    }
+  }
+
+  void write(const char *data, size_t len) {
+    if (len_ + len > sizeof(buf_)) flush_();
+    if (len > sizeof(buf_)) {
+      httpd_resp_send_chunk(req_, data, len);
+      total_ += len;
+      return;
+    }
+    memcpy(buf_ + len_, data, len);
+    len_ += len;
+  }
+
+  // Завершает ответ; возвращает число отправленных байт тела
+  size_t finish() {
+    flush_();
+    httpd_resp_send_chunk(req_, nullptr, 0);
+    return total_;
+  }
+
+ protected:
+  void flush_() {
+    if (len_ == 0) return;
+    httpd_resp_send_chunk(req_, buf_, len_);
+    total_ += len_;
+    len_ = 0;
+  }
+
+  httpd_req_t *req_;
+  char buf_[512];
+  size_t len_{0};
+  size_t total_{0};
+};
+#endif  // USE_HYDRO_REST_API
+
+// Счётчики производительности контроллера. Запись не выделяет память;
+// маршруты пишутся из задачи httpd, loop и NVS — из задачи loop.
+class Metrics {
+ public:
+#ifdef USE_HYDRO_REST_API
+  void record_request(Route route, uint32_t us, size_t bytes) {
+    if (route >= ROUTE_COUNT) return;
+    routes_[route].latency.record(HTTP_LATENCY_BOUNDS, us);
+    routes_[route].bytes += bytes;
+  }
+#endif
+  void record_loop(uint32_t us) { loop_.record(LOOP_TIME_BOUNDS, us); }
+  void record_nvs_flush(uint32_t us) { nvs_flush_.record(NVS_FLUSH_BOUNDS, us); }
+
+  // Минимум свободной внутренней памяти, замеренный вокруг обработчиков
+  void sample_heap() {
+    const uint32_t free_heap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    if (free_heap < heap_low_water_) heap_low_water_ = free_heap;
+  }
+
+#ifdef USE_HYDRO_REST_API
+  void write(ChunkedWriter &w) const {
+    w.printf("# HELP hydro_http_request_duration_seconds Handler latency per route.\n"
+             "# TYPE hydro_http_request_duration_seconds histogram\n");
+    for (uint8_t r = 0; r < ROUTE_COUNT; r++)
+      write_histogram_(w, "hydro_http_request_duration_seconds", ROUTE_LABELS[r], routes_[r].latency,
+                       HTTP_LATENCY_BOUNDS);
+
+    w.printf("# HELP hydro_http_response_bytes_total Response body bytes per route.\n"
+             "# TYPE hydro_http_response_bytes_total counter\n");
+    for (uint8_t r = 0; r < ROUTE_COUNT; r++)
+      w.printf("hydro_http_response_bytes_total{route=\"%s\"} %u\n", ROUTE_LABELS[r], (unsigned) routes_[r].bytes);
+
+    w.printf("# HELP hydro_loop_duration_seconds Time spent in HydroponicController::loop().\n"
+             "# TYPE hydro_loop_duration_seconds histogram\n");
+    write_histogram_(w, "hydro_loop_duration_seconds", nullptr, loop_, LOOP_TIME_BOUNDS);
+
+    w.printf("# HELP hydro_nvs_flush_duration_seconds Settings save duration including NVS commit.\n"
+             "# TYPE hydro_nvs_flush_duration_seconds histogram\n");
+    write_histogram_(w, "hydro_nvs_flush_duration_seconds", nullptr, nvs_flush_, NVS_FLUSH_BOUNDS);
+
+    w.printf("# HELP hydro_heap_free_bytes Free internal heap.\n"
+             "# TYPE hydro_heap_free_bytes gauge\n"
+             "hydro_heap_free_bytes %u\n"
+             "# HELP hydro_heap_handler_low_water_bytes Lowest free internal heap seen around API handlers.\n"
+             "# TYPE hydro_heap_handler_low_water_bytes gauge\n"
+             "hydro_heap_handler_low_water_bytes %u\n"
+             "# HELP hydro_heap_min_free_bytes Lowest free internal heap since boot.\n"
+             "# TYPE hydro_heap_min_free_bytes gauge\n"
+             "hydro_heap_min_free_bytes %u\n",
+             (unsigned) heap_caps_get_free_size(MALLOC_CAP_INTERNAL), (unsigned) heap_low_water_,
+             (unsigned) heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+  }
+#endif
+
+ protected:
+#ifdef USE_HYDRO_REST_API
+  struct RouteStats {
+    Histogram latency;
+    uint32_t bytes{0};
+  };
+
+  static void write_histogram_(ChunkedWriter &w, const char *name, const char *route, const Histogram &h,
+                               const HistogramBounds &bounds) {
+    char labels[48] = "";
+    if (route != nullptr) snprintf(labels, sizeof(labels), "route=\"%s\",", route);
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < HIST_BUCKETS; i++) {
+      cumulative += h.buckets[i];
+      w.printf("%s_bucket{%sle=\"%s\"} %u\n", name, labels, bounds.le[i], (unsigned) cumulative);
+    }
+    w.printf("%s_bucket{%sle=\"+Inf\"} %u\n", name, labels, (unsigned) h.count);
+    if (route != nullptr) labels[strlen(labels) - 1] = '\0';  // без завершающей запятой
+    const char *open = route != nullptr ? "{" : "";
+    const char *close = route != nullptr ? "}" : "";
+    w.printf("%s_sum%s%s%s %u.%06u\n", name, open, labels, close, (unsigned) (h.sum_us / 1000000),
+             (unsigned) (h.sum_us % 1000000));
+    w.printf("%s_count%s%s%s %u\n", name, open, labels, close, (unsigned) h.count);
+  }
+
+  RouteStats routes_[ROUTE_COUNT];
+#endif
+  Histogram loop_;
+  Histogram nvs_flush_;
+  uint32_t heap_low_water_{UINT32_MAX};
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_HYDRO_POWER_SAVE
+
+#include "esphome/core/hal.h"
+
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <soc/soc_caps.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Light sleep между дедлайнами расписаний.
+// millis() идёт от esp_timer, который после light sleep досчитывается по RTC, поэтому
+// дедлайны в куче и фаза цикла (last_change_ms_) не сдвигаются; просыпаемся за guard до
+// ближайшего дедлайна и отрабатываем его обычным путём в loop().
+class PowerSave {
+ public:
+  static const uint8_t MAX_HOLD_PINS = 4;
+  static const uint32_t MIN_SLEEP_MS = 20;
+
+  void set_max_sleep(uint32_t ms) { max_sleep_ms_ = ms; }
+  void set_guard(uint32_t ms) { guard_ms_ = ms; }
+  void set_awake_after_activity(uint32_t ms) { awake_after_activity_ms_ = ms; }
+  void add_hold_pin(int pin) {
+    if (hold_count_ < MAX_HOLD_PINS) hold_pins_[hold_count_++] = (gpio_num_t) pin;
+  }
+
+  void setup() {
+#if SOC_PM_SUPPORT_WIFI_WAKEUP
+    // Кадр для станции будит чип, и веб-интерфейс отвечает без ожидания конца сна
+    esp_sleep_enable_wifi_wakeup();
+#endif
+    start_us_ = esp_timer_get_time();
+  }
+
+  // Из задачи httpd: после запроса устройство не спит awake_after_activity
+  void note_activity() { last_activity_ms_ = millis(); }
+
+  // budget_ms — время до ближайшего дедлайна узла (0 — спать нельзя); outputs_steady — все
+  // PWM-выходы на 0 или 100 %, их уровень можно удержать защёлкой пина на время сна
+  void idle(uint32_t now, uint32_t budget_ms, bool outputs_steady) {
+    if (budget_ms <= guard_ms_ + MIN_SLEEP_MS || now - last_activity_ms_ < awake_after_activity_ms_) return;
+    if (!outputs_steady) {
+      blocked_by_pwm_++;
+      return;
+    }
+    const uint32_t sleep_ms = std::min(budget_ms - guard_ms_, max_sleep_ms_);
+    for (uint8_t i = 0; i < hold_count_; i++) gpio_hold_en(hold_pins_[i]);
+    esp_sleep_enable_timer_wakeup((uint64_t) sleep_ms * 1000ULL);
+    const int64_t start = esp_timer_get_time();
+    esp_light_sleep_start();
+    slept_us_ += esp_timer_get_time() - start;
+    for (uint8_t i = 0; i < hold_count_; i++) gpio_hold_dis(hold_pins_[i]);
+    sleeps_++;
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER) early_wakeups_++;
+  }
+
+  // Доля времени во сне с момента старта, в десятых процента
+  uint32_t sleep_permille() const {
+    const int64_t total = esp_timer_get_time() - start_us_;
+    return total > 0 ? (uint32_t) (slept_us_ * 1000 / total) : 0;
+  }
+  uint64_t slept_us() const { return slept_us_; }
+  uint32_t sleeps() const { return sleeps_; }
+  uint32_t early_wakeups() const { return early_wakeups_; }
+  uint32_t blocked_by_pwm() const { return blocked_by_pwm_; }
+  uint32_t get_max_sleep() const { return max_sleep_ms_; }
+  uint32_t get_awake_after_activity() const { return awake_after_activity_ms_; }
+
+ protected:
+  uint32_t max_sleep_ms_{500};
+  uint32_t guard_ms_{10};
+  uint32_t awake_after_activity_ms_{30000};
+  gpio_num_t hold_pins_[MAX_HOLD_PINS]{};
+  uint8_t hold_count_{0};
+  std::atomic<uint32_t> last_activity_ms_{0};
+
+  int64_t start_us_{0};
+  uint64_t slept_us_{0};
+  uint32_t sleeps_{0};
+  uint32_t early_wakeups_{0};
+  uint32_t blocked_by_pwm_{0};
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
+
+#endif  // USE_HYDRO_POWER_SAVE
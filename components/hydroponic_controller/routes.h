@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Маршруты API; индекс используется в таблице метрик
+enum Route : uint8_t {
+  ROUTE_INDEX = 0,
+  ROUTE_STATE,
+  ROUTE_PUMP,
+  ROUTE_PUMP_CYCLE,
+  ROUTE_LIGHT,
+  ROUTE_LIGHT_SCHEDULE,
+  ROUTE_BATCH,
+  ROUTE_EVENTS,
+  ROUTE_EVENTS_STREAM,
+  ROUTE_METRICS,
+  ROUTE_HISTORY,
+  ROUTE_COUNT,
+  ROUTE_NONE = 0xFF,
+};
+
+// Метки маршрутов в /api/metrics
+static const char *const ROUTE_LABELS[ROUTE_COUNT] = {
+    "/",
+    "/api/state",
+    "/api/pump",
+    "/api/pump-cycle",
+    "/api/light",
+    "/api/light-schedule",
+    "/api/batch",
+    "/api/events",
+    "/api/events/stream",
+    "/api/metrics",
+    "/api/history",
+};
+
+// FNV-1a пути; constexpr, чтобы пути маршрутов были метками case
+constexpr uint32_t path_hash(const char *s, size_t n, uint32_t h = 2166136261u) {
+  return n == 0 ? h : path_hash(s + 1, n - 1, (h ^ (uint8_t) *s) * 16777619u);
+}
+template<size_t N> constexpr uint32_t path_hash(const char (&path)[N]) { return path_hash(path, N - 1); }
+template<size_t N> inline bool path_is(const char *s, size_t n, const char (&path)[N]) {
+  return n == N - 1 && memcmp(s, path, N - 1) == 0;
+}
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Очередь дедлайнов расписаний (min-heap по времени millis()).
+// loop() проверяет только вершину кучи, поэтому его стоимость не зависит от числа правил.
+// Дедлайны сравниваются через знаковую разность, что переживает переполнение millis(),
+// пока все они лежат в пределах ~24 суток друг от друга.
+template<uint8_t N> class DeadlineQueue {
+ public:
+  static const uint8_t NONE = 0xFF;
+
+  DeadlineQueue() {
+    for (auto &p : pos_) p = NONE;
+  }
+
+  // Ставит или переносит дедлайн правила id (< N)
+  void schedule(uint8_t id, uint32_t deadline) {
+    if (id >= N) return;
+    if (pos_[id] != NONE) {
+      const uint8_t i = pos_[id];
+      const bool earlier = before_(deadline, heap_[i].deadline);
+      heap_[i].deadline = deadline;
+      if (earlier) sift_up_(i); else sift_down_(i);
+      return;
+    }
+    heap_[size_] = {deadline, id};
+    pos_[id] = size_;
+    sift_up_(size_++);
+  }
+
+  void cancel(uint8_t id) {
+    if (id >= N || pos_[id] == NONE) return;
+    remove_at_(pos_[id]);
+  }
+
+  bool is_scheduled(uint8_t id) const { return id < N && pos_[id] != NONE; }
+  bool empty() const { return size_ == 0; }
+  uint8_t size() const { return size_; }
+
+  bool due(uint32_t now) const { return size_ != 0 && (int32_t)(now - heap_[0].deadline) >= 0; }
+  uint32_t next_deadline() const { return heap_[0].deadline; }
+
+  // Снимает ближайшее правило; вызывать только после due()
+  uint8_t pop() {
+    const uint8_t id = heap_[0].id;
+    remove_at_(0);
+    return id;
+  }
+
+ protected:
+  struct Entry {
+    uint32_t deadline;
+    uint8_t id;
+  };
+
+  static bool before_(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+  void swap_(uint8_t a, uint8_t b) {
+    const Entry t = heap_[a];
+    heap_[a] = heap_[b];
+    heap_[b] = t;
+    pos_[heap_[a].id] = a;
+    pos_[heap_[b].id] = b;
+  }
+
+  void sift_up_(uint8_t i) {
+    while (i > 0) {
+      const uint8_t parent = (i - 1) / 2;
+      if (!before_(heap_[i].deadline, heap_[parent].deadline)) break;
+      swap_(i, parent);
+      i = parent;
+    }
+  }
+
+  void sift_down_(uint8_t i) {
+    for (;;) {
+      uint8_t smallest = i;
+      const uint8_t l = 2 * i + 1, r = 2 * i + 2;
+      if (l < size_ && before_(heap_[l].deadline, heap_[smallest].deadline)) smallest = l;
+      if (r < size_ && before_(heap_[r].deadline, heap_[smallest].deadline)) smallest = r;
+      if (smallest == i) break;
+      swap_(i, smallest);
+      i = smallest;
+    }
+  }
+
+  void remove_at_(uint8_t i) {
+    pos_[heap_[i].id] = NONE;
+    size_--;
+    if (i == size_) return;
+    heap_[i] = heap_[size_];
+    pos_[heap_[i].id] = i;
+    sift_down_(i);
+    sift_up_(i);
+  }
+
+  Entry heap_[N];
+  uint8_t pos_[N];
+  uint8_t size_{0};
+};
+
+// Расчёты расписаний ниже не зависят от ESPHome; на хосте их проверяет host/schedule_replay.cpp
+// на виртуальных часах.
+
+// Длительность текущей фазы цикла помпы
+inline uint32_t pump_phase_ms(bool running_on, int on_minutes, int off_minutes) {
+  return (uint32_t)(running_on ? on_minutes : off_minutes) * 60000UL;
+}
+
+// Окно света [on, off) в минутах от полуночи; on > off — окно через полночь
+inline bool light_window_contains(int on_minutes, int off_minutes, int minute) {
+  if (on_minutes < off_minutes) return minute >= on_minutes && minute < off_minutes;
+  return minute >= on_minutes || minute < off_minutes;
+}
+
+// Миллисекунды до ближайшей границы окна света (включения или выключения)
+inline uint32_t ms_to_next_light_edge(int on_minutes, int off_minutes, int minute, int second) {
+  auto until = [minute](int edge) {
+    const int d = (edge - minute + 1440) % 1440;
+    return d == 0 ? 1440 : d;
+  };
+  const int to_on = until(on_minutes), to_off = until(off_minutes);
+  const int next = to_on < to_off ? to_on : to_off;
+  return (uint32_t)(next * 60 - second) * 1000UL;
+}
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
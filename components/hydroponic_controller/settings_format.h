@@ -0,0 +1,137 @@
+#pragma once
+
+#include "channels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Формат v1 ("hydro_settings"): struct с одной помпой и одним светом, CRC по сырым
+// байтам вместе с выравниванием. Только для чтения при миграции — раскладку не менять.
+struct LegacySettings {
+  bool enabled = false;
+  int on_minutes = 5;
+  int off_minutes = 15;
+  bool light_sched_enabled = false;
+  int light_on_minutes = 1080;   // 18:00
+  int light_off_minutes = 540;   // 09:00
+  uint32_t crc = 0;
+
+  uint32_t calculate_crc() const {
+    uint32_t hash = 2166136261u;
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(this);
+    for (size_t i = 0; i < sizeof(LegacySettings) - sizeof(crc); i++) {
+      hash ^= data[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+};
+
+// Формат v2 ("hydro_settings_v2"): байтовый образ с явной раскладкой, не зависящей от
+// компилятора. Все многобайтовые поля little-endian.
+//   0  'H' 'T'       magic
+//   2  u8            version
+//   3  u8            число каналов помп
+//   4  u8            число каналов света
+//   5  3 байта       резерв, 0
+//   8  записи каналов: сначала помпы, затем свет, MAX_CHANNELS каждого типа
+//      u8 flags (бит 0 — расписание включено), u16 on, u16 off
+// CRC (FNV-1a) считается по всему образу и хранится отдельным полем.
+struct PackedSettings {
+  static const uint8_t VERSION = 2;
+  static const size_t HEADER_SIZE = 8;
+  static const size_t RECORD_SIZE = 5;
+  static const size_t SIZE = HEADER_SIZE + 2 * MAX_CHANNELS * RECORD_SIZE;
+  static const uint8_t FLAG_ENABLED = 1 << 0;
+
+  uint8_t bytes[SIZE]{};
+  uint32_t crc = 0;
+
+  uint32_t calculate_crc() const {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < SIZE; i++) {
+      hash ^= bytes[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+};
+static_assert(sizeof(PackedSettings) == PackedSettings::SIZE + sizeof(uint32_t), "PackedSettings must have no padding");
+
+inline void put_u16_le(uint8_t *p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+inline uint16_t get_u16_le(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+inline void encode_settings(const ScheduleTable &pumps, const ScheduleTable &lights, PackedSettings *out) {
+  memset(out->bytes, 0, sizeof(out->bytes));
+  uint8_t *p = out->bytes;
+  p[0] = 'H';
+  p[1] = 'T';
+  p[2] = PackedSettings::VERSION;
+  p[3] = pumps.count;
+  p[4] = lights.count;
+  p += PackedSettings::HEADER_SIZE;
+  for (const ScheduleTable *t : {&pumps, &lights}) {
+    for (uint8_t ch = 0; ch < MAX_CHANNELS; ch++, p += PackedSettings::RECORD_SIZE) {
+      if (ch >= t->count) continue;
+      p[0] = t->enabled[ch] ? PackedSettings::FLAG_ENABLED : 0;
+      put_u16_le(p + 1, t->on_minutes[ch]);
+      put_u16_le(p + 3, t->off_minutes[ch]);
+    }
+  }
+}
+
+// Восстанавливает каналы, которые есть и в образе, и в конфигурации; остальные
+// сохраняют значения из YAML. false — чужой или повреждённый образ (таблицы не меняются).
+inline bool decode_settings(const PackedSettings &in, ScheduleTable *pumps, ScheduleTable *lights) {
+  const uint8_t *p = in.bytes;
+  if (p[0] != 'H' || p[1] != 'T' || p[2] != PackedSettings::VERSION) return false;
+  if (p[3] > MAX_CHANNELS || p[4] > MAX_CHANNELS) return false;
+  // Диапазоны как у ключей /api/batch: помпа 1-120 мин, окно света 0-1439
+  const uint16_t max_value[2] = {120, 1439};
+  const uint16_t min_value[2] = {1, 0};
+  const uint8_t *rec = p + PackedSettings::HEADER_SIZE;
+  for (uint8_t t = 0; t < 2; t++) {
+    for (uint8_t ch = 0; ch < p[3 + t]; ch++) {
+      const uint8_t *r = rec + (t * MAX_CHANNELS + ch) * PackedSettings::RECORD_SIZE;
+      for (const uint16_t v : {get_u16_le(r + 1), get_u16_le(r + 3)}) {
+        if (v < min_value[t] || v > max_value[t]) return false;
+      }
+    }
+  }
+  ScheduleTable *tables[2] = {pumps, lights};
+  for (uint8_t t = 0; t < 2; t++) {
+    const uint8_t n = p[3 + t] < tables[t]->count ? p[3 + t] : tables[t]->count;
+    for (uint8_t ch = 0; ch < n; ch++) {
+      const uint8_t *r = rec + (t * MAX_CHANNELS + ch) * PackedSettings::RECORD_SIZE;
+      tables[t]->enabled[ch] = r[0] & PackedSettings::FLAG_ENABLED;
+      tables[t]->on_minutes[ch] = get_u16_le(r + 1);
+      tables[t]->off_minutes[ch] = get_u16_le(r + 3);
+    }
+  }
+  return true;
+}
+
+// v1 -> v2: старые настройки переходят в канал 0
+inline void migrate_settings(const LegacySettings &in, ScheduleTable *pumps, ScheduleTable *lights) {
+  if (pumps->count > 0) {
+    pumps->enabled[0] = in.enabled;
+    pumps->on_minutes[0] = in.on_minutes;
+    pumps->off_minutes[0] = in.off_minutes;
+  }
+  if (lights->count > 0) {
+    lights->enabled[0] = in.light_sched_enabled;
+    lights->on_minutes[0] = in.light_on_minutes;
+    lights->off_minutes[0] = in.light_off_minutes;
+  }
+}
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+#include "esphome/core/preferences.h"
+
+#include <atomic>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Отложенная запись настроек во flash.
+// Обработчики API только помечают настройки изменёнными и сразу отвечают; запись
+// выполняется из loop() после паузы debounce (или не позже MAX_DIRTY_MS), а
+// запись с тем же CRC, что уже лежит во flash, пропускается.
+// T должен иметь поле crc и метод calculate_crc().
+template<typename T> class SettingsStore {
+ public:
+  static const uint32_t MAX_DIRTY_MS = 60000;
+
+  void init(uint32_t key) { pref_ = global_preferences->make_preference<T>(key); }
+  void set_debounce(uint32_t ms) { debounce_ms_ = ms; }
+  uint32_t get_debounce() const { return debounce_ms_; }
+
+  // false — записи нет или CRC не совпал
+  bool load(T *out) {
+    T loaded;
+    if (!pref_.load(&loaded) || loaded.crc != loaded.calculate_crc())
+      return false;
+    *out = loaded;
+    stored_crc_ = loaded.crc;
+    has_stored_ = true;
+    loaded_ = true;
+    return true;
+  }
+
+  // Можно вызывать из задачи httpd. Отметки времени пишутся до флага, чтобы due()
+  // в loop() не увидел dirty_ со временем прошлой серии
+  void mark_dirty() {
+    const uint32_t now = millis();
+    last_mark_ms_ = now;
+    if (!dirty_)
+      first_mark_ms_ = now;
+    dirty_ = true;
+  }
+
+  bool dirty() const { return dirty_; }
+
+  bool due(uint32_t now) const {
+    return dirty_ && (now - last_mark_ms_ >= debounce_ms_ || now - first_mark_ms_ >= MAX_DIRTY_MS);
+  }
+
+  // encode(T *) заполняет образ настроек. Флаг снимается до кодирования: изменение,
+  // пришедшее во время flush(), снова пометит настройки и запишется следующим.
+  // Возвращает false только при ошибке записи
+  template<typename Encode> bool flush(Encode encode) {
+    dirty_.exchange(false);
+    T s;
+    encode(&s);
+    s.crc = s.calculate_crc();
+    if (has_stored_ && s.crc == stored_crc_) {
+      skipped_++;
+      return true;
+    }
+    const uint32_t start = micros();
+    const bool ok = pref_.save(&s) && global_preferences->sync();
+    last_flush_us_ = micros() - start;
+    if (last_flush_us_ > max_flush_us_)
+      max_flush_us_ = last_flush_us_;
+    if (!ok) {
+      failures_++;
+      return false;
+    }
+    writes_++;
+    stored_crc_ = s.crc;
+    has_stored_ = true;
+    return true;
+  }
+
+  bool loaded() const { return loaded_; }
+  uint32_t writes() const { return writes_; }
+  uint32_t skipped() const { return skipped_; }
+  uint32_t failures() const { return failures_; }
+  uint32_t last_flush_us() const { return last_flush_us_; }
+  uint32_t max_flush_us() const { return max_flush_us_; }
+
+ protected:
+  ESPPreferenceObject pref_;
+  uint32_t debounce_ms_{5000};
+  std::atomic<bool> dirty_{false};
+  std::atomic<uint32_t> first_mark_ms_{0};
+  std::atomic<uint32_t> last_mark_ms_{0};
+  uint32_t stored_crc_{0};
+  bool has_stored_{false};
+  bool loaded_{false};
+
+  uint32_t writes_{0};
+  uint32_t skipped_{0};
+  uint32_t failures_{0};
+  uint32_t last_flush_us_{0};
+  uint32_t max_flush_us_{0};
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "channels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Поля состояния, по которым поток событий отправляет только изменения.
+// Плоские поля описывают канал 0, FIELD_CHANNELS — массивы "pumps" и "lights" со всеми каналами.
+enum StateField : uint8_t {
+  FIELD_PUMP_ON = 1 << 0,
+  FIELD_PUMP_SPEED = 1 << 1,
+  FIELD_PUMP_SCHED = 1 << 2,
+  FIELD_LIGHT_ON = 1 << 3,
+  FIELD_LIGHT_BRIGHTNESS = 1 << 4,
+  FIELD_LIGHT_SCHED = 1 << 5,
+  FIELD_CHANNELS = 1 << 6,
+  FIELD_ALL = 0x7F,
+};
+// Буфер JSON полного состояния при MAX_CHANNELS каналах каждого типа
+static const size_t STATE_JSON_SIZE = 1024;
+
+// Состояние канала: level — скорость помпы или яркость света, %
+struct ChannelState {
+  bool on = false;
+  int level = 0;
+  bool sched = false;
+  int on_minutes = 0;
+  int off_minutes = 0;
+
+  bool sched_differs(const ChannelState &o) const {
+    return sched != o.sched || on_minutes != o.on_minutes || off_minutes != o.off_minutes;
+  }
+  bool differs(const ChannelState &o) const { return on != o.on || level != o.level || sched_differs(o); }
+};
+
+// Снимок состояния для /api/state и /api/events/stream
+struct StateSnapshot {
+  uint8_t pump_count = 0;
+  uint8_t light_count = 0;
+  ChannelState pumps[MAX_CHANNELS];
+  ChannelState lights[MAX_CHANNELS];
+
+  uint8_t diff(const StateSnapshot &o) const {
+    uint8_t f = 0;
+    if (pumps[0].on != o.pumps[0].on) f |= FIELD_PUMP_ON;
+    if (pumps[0].level != o.pumps[0].level) f |= FIELD_PUMP_SPEED;
+    if (pumps[0].sched_differs(o.pumps[0])) f |= FIELD_PUMP_SCHED;
+    if (lights[0].on != o.lights[0].on) f |= FIELD_LIGHT_ON;
+    if (lights[0].level != o.lights[0].level) f |= FIELD_LIGHT_BRIGHTNESS;
+    if (lights[0].sched_differs(o.lights[0])) f |= FIELD_LIGHT_SCHED;
+    bool channels = f != 0 || pump_count != o.pump_count || light_count != o.light_count;
+    for (uint8_t ch = 1; ch < MAX_CHANNELS && !channels; ch++)
+      channels = pumps[ch].differs(o.pumps[ch]) || lights[ch].differs(o.lights[ch]);
+    if (channels) f |= FIELD_CHANNELS;
+    return f;
+  }
+
+  // JSON только с полями из маски; возвращает длину
+  size_t to_json(char *buf, size_t size, uint8_t fields) const {
+    if (size < 3) return 0;
+    size_t n = 0;
+    buf[n++] = '{';
+    auto put = [&](const char *fmt, auto... args) {
+      if (n < size) n += snprintf(buf + n, size - n, fmt, args...);
+    };
+    auto flag = [](bool b) { return b ? "true" : "false"; };
+    const ChannelState &pump = pumps[0], &light = lights[0];
+    if (fields & FIELD_PUMP_ON) put("\"pump_on\":%s,", flag(pump.on));
+    if (fields & FIELD_PUMP_SPEED) put("\"pump_speed\":%d,", pump.level);
+    if (fields & FIELD_PUMP_SCHED)
+      put("\"pump_sched\":{\"enabled\":%s,\"on\":%d,\"off\":%d},", flag(pump.sched), pump.on_minutes,
+          pump.off_minutes);
+    if (fields & FIELD_LIGHT_ON) put("\"light_on\":%s,", flag(light.on));
+    if (fields & FIELD_LIGHT_BRIGHTNESS) put("\"light_brightness\":%d,", light.level);
+    if (fields & FIELD_LIGHT_SCHED)
+      put("\"light_sched\":{\"enabled\":%s,\"on\":%d,\"off\":%d},", flag(light.sched), light.on_minutes,
+          light.off_minutes);
+    if (fields & FIELD_CHANNELS) {
+      const struct {
+        const char *name, *level;
+        const ChannelState *ch;
+        uint8_t count;
+      } groups[2] = {{"pumps", "speed", pumps, pump_count}, {"lights", "brightness", lights, light_count}};
+      for (const auto &g : groups) {
+        put("\"%s\":[", g.name);
+        for (uint8_t i = 0; i < g.count; i++) {
+          const ChannelState &c = g.ch[i];
+          put("%s{\"on\":%s,\"%s\":%d,\"sched\":{\"enabled\":%s,\"on\":%d,\"off\":%d}}", i > 0 ? "," : "",
+              flag(c.on), g.level, c.level, flag(c.sched), c.on_minutes, c.off_minutes);
+        }
+        put("%s", "],");
+      }
+    }
+    if (n >= size) return 0;
+    if (n > 1) n--;  // лишняя запятая
+    buf[n++] = '}';
+    buf[n] = '\0';
+    return n;
+  }
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
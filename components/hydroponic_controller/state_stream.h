@@ -0,0 +1,144 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_HYDRO_REST_API
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/components/web_server_idf/web_server_idf.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Подписчики /api/events/stream (Server-Sent Events).
+// Клиенты добавляются из задачи httpd, а данные в сокеты пишутся только из loop().
+class StateStream {
+ public:
+  static const uint8_t MAX_CLIENTS = 8;
+  static const uint32_t KEEPALIVE_MS = 15000;
+  // JSON полного состояния всех каналов плюс обрамление чанка
+  static const size_t MAX_FRAME = 1040;
+
+  void set_max_clients(uint8_t n) { max_clients_ = n < MAX_CLIENTS ? n : MAX_CLIENTS; }
+  uint8_t get_max_clients() const { return max_clients_; }
+
+  // Отправляет заголовки SSE и занимает слот; false — все слоты заняты
+  bool subscribe(AsyncWebServerRequest *req) {
+    httpd_req_t *r = *req;
+    LockGuard guard(lock_);
+    Client *slot = nullptr;
+    for (uint8_t i = 0; i < max_clients_; i++) {
+      if (!clients_[i].active) {
+        slot = &clients_[i];
+        break;
+      }
+    }
+    if (slot == nullptr)
+      return false;
+
+    httpd_resp_set_status(r, "200 OK");
+    httpd_resp_set_type(r, "text/event-stream");
+    httpd_resp_set_hdr(r, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(r, "Connection", "keep-alive");
+    httpd_resp_send_chunk(r, "retry: 5000\n\n", 13);
+
+    slot->owner = this;
+    slot->hd = r->handle;
+    slot->fd = httpd_req_to_sockfd(r);
+    slot->fresh = true;
+    slot->active = true;
+    r->sess_ctx = slot;
+    r->free_ctx = StateStream::on_session_closed_;
+    count_++;
+    has_fresh_ = true;
+    return true;
+  }
+
+  uint8_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  bool has_fresh() const { return has_fresh_; }
+
+  // Изменённые поля — всем, кто уже получил полный снимок
+  void broadcast(const char *json, size_t len) { send_(json, len, false); }
+  // Полный снимок — только что подключившимся клиентам
+  void send_full(const char *json, size_t len) {
+    has_fresh_ = false;
+    send_(json, len, true);
+  }
+
+  void keepalive(uint32_t now) {
+    if (count_ == 0 || now - last_send_ms_ < KEEPALIVE_MS)
+      return;
+    static const char PING[] = "8\r\n: ping\n\n\r\n";
+    LockGuard guard(lock_);
+    for (auto &c : clients_) {
+      if (c.active && !c.fresh)
+        write_(c, PING, sizeof(PING) - 1);
+    }
+    last_send_ms_ = now;
+  }
+
+ protected:
+  struct Client {
+    StateStream *owner{nullptr};
+    httpd_handle_t hd{nullptr};
+    int fd{-1};
+    bool fresh{false};
+    bool active{false};
+  };
+
+  static void on_session_closed_(void *ctx) {
+    auto *c = static_cast<Client *>(ctx);
+    StateStream *owner = c->owner;
+    LockGuard guard(owner->lock_);
+    if (c->active) {
+      c->active = false;
+      owner->count_--;
+    }
+  }
+
+  void send_(const char *json, size_t len, bool fresh) {
+    // Чанк HTTP: "<hex>\r\ndata: <json>\n\n\r\n"
+    char frame[MAX_FRAME];
+    const size_t payload = len + 8;
+    int n = snprintf(frame, sizeof(frame), "%x\r\ndata: ", (unsigned) payload);
+    if (n < 0 || n + len + 4 > sizeof(frame))
+      return;
+    memcpy(frame + n, json, len);
+    memcpy(frame + n + len, "\n\n\r\n", 4);
+    const size_t total = n + len + 4;
+
+    LockGuard guard(lock_);
+    for (auto &c : clients_) {
+      if (!c.active || c.fresh != fresh)
+        continue;
+      c.fresh = false;
+      write_(c, frame, total);
+    }
+    last_send_ms_ = millis();
+  }
+
+  void write_(Client &c, const char *data, size_t len) {
+    if (httpd_socket_send(c.hd, c.fd, data, len, 0) < 0) {
+      // Сессию закроет httpd, слот освободится в on_session_closed_
+      httpd_sess_trigger_close(c.hd, c.fd);
+    }
+  }
+
+  Client clients_[MAX_CLIENTS];
+  Mutex lock_;
+  uint8_t max_clients_{4};
+  std::atomic<uint8_t> count_{0};
+  std::atomic<bool> has_fresh_{false};
+  uint32_t last_send_ms_{0};
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
+
+#endif  // USE_HYDRO_REST_API
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "command.h"
+#include "settings_format.h"
+#include "state_snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Двоичный протокол WebSocket. Каждое сообщение — один binary-кадр, поля little-endian.
+//
+// Клиент -> устройство: u8 op, u16 req (номер запроса, возвращается в ACK), данные:
+//   SUBSCRIBE    —                       ACK, затем STATE и DELTA при каждом изменении
+//   UNSUBSCRIBE  —                       ACK
+//   GET_STATE    —                       ACK, затем STATE
+//   COMMAND      u16 mask, i16 value[]   ACK; mask и значения — как в Command: по одному
+//                                        значению на каждый установленный бит, по возрастанию
+// Устройство -> клиент:
+//   ACK    u8 op, u16 req, u8 status
+//   STATE  u8 op, u32 seq, u8 pumps, u8 lights, запись на каждый канал (сначала помпы)
+//   DELTA  u8 op, u32 seq, u32 base, u8 n, n x (u8 id, запись); применять, только если
+//          у клиента состояние base, иначе запросить GET_STATE
+// Запись канала (6 байт): u8 flags (бит 0 — включён, бит 1 — расписание), u8 level,
+// u16 on, u16 off. id канала в DELTA: бит 7 — свет, биты 0-6 — номер канала.
+enum WsOp : uint8_t {
+  WS_OP_SUBSCRIBE = 0x01,
+  WS_OP_UNSUBSCRIBE = 0x02,
+  WS_OP_GET_STATE = 0x03,
+  WS_OP_COMMAND = 0x04,
+  WS_OP_ACK = 0x81,
+  WS_OP_STATE = 0x82,
+  WS_OP_DELTA = 0x83,
+};
+
+enum WsStatus : uint8_t {
+  WS_OK = 0,
+  WS_BAD_FRAME = 1,       // неизвестный op или длина не совпадает
+  WS_BAD_VALUE = 2,       // поле вне диапазона /api/batch
+  WS_UNKNOWN_CHANNEL = 3,
+};
+
+static const size_t WS_REQUEST_HEADER = 3;
+static const size_t WS_RECORD_SIZE = 6;
+static const uint8_t WS_ID_LIGHT = 0x80;
+static const uint8_t WS_FLAG_ON = 1 << 0;
+static const uint8_t WS_FLAG_SCHED = 1 << 1;
+// Самый длинный кадр — DELTA со всеми каналами; входящие кадры короче
+static const size_t WS_MAX_FRAME = 1 + 4 + 4 + 1 + 2 * MAX_CHANNELS * (1 + WS_RECORD_SIZE);
+
+inline uint8_t *ws_put_u32(uint8_t *p, uint32_t v) {
+  for (uint8_t i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+  return p + 4;
+}
+
+inline uint8_t *ws_put_record(uint8_t *p, const ChannelState &c) {
+  p[0] = (c.on ? WS_FLAG_ON : 0) | (c.sched ? WS_FLAG_SCHED : 0);
+  p[1] = (uint8_t) c.level;
+  put_u16_le(p + 2, c.on_minutes);
+  put_u16_le(p + 4, c.off_minutes);
+  return p + WS_RECORD_SIZE;
+}
+
+// Кодировщики пишут в буфер не короче WS_MAX_FRAME и возвращают длину кадра
+inline size_t ws_encode_ack(uint8_t *out, uint16_t req, WsStatus status) {
+  out[0] = WS_OP_ACK;
+  put_u16_le(out + 1, req);
+  out[3] = status;
+  return 4;
+}
+
+inline size_t ws_encode_state(uint8_t *out, uint32_t seq, const StateSnapshot &s) {
+  uint8_t *p = out;
+  *p++ = WS_OP_STATE;
+  p = ws_put_u32(p, seq);
+  *p++ = s.pump_count;
+  *p++ = s.light_count;
+  for (uint8_t ch = 0; ch < s.pump_count; ch++) p = ws_put_record(p, s.pumps[ch]);
+  for (uint8_t ch = 0; ch < s.light_count; ch++) p = ws_put_record(p, s.lights[ch]);
+  return p - out;
+}
+
+// Только каналы, изменившиеся между prev и s; 0 — изменений нет или изменилось число каналов
+inline size_t ws_encode_delta(uint8_t *out, uint32_t seq, uint32_t base, const StateSnapshot &s,
+                              const StateSnapshot &prev) {
+  if (s.pump_count != prev.pump_count || s.light_count != prev.light_count) return 0;
+  uint8_t *p = out;
+  *p++ = WS_OP_DELTA;
+  p = ws_put_u32(p, seq);
+  p = ws_put_u32(p, base);
+  uint8_t *count = p++;
+  *count = 0;
+  for (uint8_t ch = 0; ch < s.pump_count; ch++) {
+    if (!s.pumps[ch].differs(prev.pumps[ch])) continue;
+    *p++ = ch;
+    p = ws_put_record(p, s.pumps[ch]);
+    (*count)++;
+  }
+  for (uint8_t ch = 0; ch < s.light_count; ch++) {
+    if (!s.lights[ch].differs(prev.lights[ch])) continue;
+    *p++ = WS_ID_LIGHT | ch;
+    p = ws_put_record(p, s.lights[ch]);
+    (*count)++;
+  }
+  return *count != 0 ? p - out : 0;
+}
+
+// Полезная нагрузка COMMAND (после заголовка запроса) -> Command; проверки как у /api/batch
+inline WsStatus ws_decode_command(const uint8_t *data, size_t len, Command *out) {
+  if (len < 2) return WS_BAD_FRAME;
+  const uint16_t mask = get_u16_le(data);
+  if ((mask >> CMD_COUNT) != 0 || (mask & ~(1u << CMD_CHANNEL)) == 0) return WS_BAD_FRAME;
+  size_t pos = 2;
+  Command cmd;
+  for (uint8_t f = 0; f < CMD_COUNT; f++) {
+    if (!(mask & (1u << f))) continue;
+    if (pos + 2 > len) return WS_BAD_FRAME;
+    const int16_t v = (int16_t) get_u16_le(data + pos);
+    pos += 2;
+    if (v < COMMAND_FIELDS[f].min || v > COMMAND_FIELDS[f].max) return WS_BAD_VALUE;
+    cmd.set(static_cast<CommandField>(f), v);
+  }
+  if (pos != len) return WS_BAD_FRAME;
+  *out = cmd;
+  return WS_OK;
+}
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_HYDRO_WS
+
+#include "esphome/core/helpers.h"
+#include "ws_protocol.h"
+
+#include <esp_http_server.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <functional>
+
+namespace esphome {
+namespace hydroponic_controller {
+
+// Двоичный протокол состояния и команд (ws_protocol.h) на отдельном экземпляре httpd.
+// Основной сервер ESPHome регистрирует обработчик "/*" для всех методов, поэтому
+// WebSocket-маршрут в нём недостижим. Кадры принимаются в задаче этого httpd,
+// состояние рассылается только из loop().
+class WsServer {
+ public:
+  static const uint8_t MAX_CLIENTS = 4;
+  using CommandHandler = std::function<WsStatus(const Command &)>;
+
+  void set_port(uint16_t port) { port_ = port; }
+  void set_max_clients(uint8_t n) { max_clients_ = n < MAX_CLIENTS ? n : MAX_CLIENTS; }
+  uint16_t get_port() const { return port_; }
+  uint8_t get_max_clients() const { return max_clients_; }
+  // Вызывается из задачи httpd для каждой команды
+  void set_on_command(CommandHandler handler) { on_command_ = std::move(handler); }
+
+  bool start() {
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = port_;
+    // Управляющий UDP-порт по умолчанию уже занят основным сервером
+    config.ctrl_port = ESP_HTTPD_DEF_CTRL_PORT + 1;
+    config.max_open_sockets = max_clients_ + 1;  // лишний сокет — чтобы ответить отказом
+    config.max_uri_handlers = 1;
+    config.lru_purge_enable = true;
+    config.global_user_ctx = this;
+    config.close_fn = WsServer::on_close_;
+    if (httpd_start(&hd_, &config) != ESP_OK) {
+      hd_ = nullptr;
+      return false;
+    }
+    httpd_uri_t uri = {};
+    uri.uri = "/ws";
+    uri.method = HTTP_GET;
+    uri.handler = WsServer::on_frame_;
+    uri.user_ctx = this;
+    uri.is_websocket = true;
+    httpd_register_uri_handler(hd_, &uri);
+    return true;
+  }
+  bool running() const { return hd_ != nullptr; }
+
+  uint8_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  bool has_fresh() const { return has_fresh_; }
+
+  // Изменившиеся каналы — подписчикам, полный снимок — тем, кто его запросил
+  void publish(const StateSnapshot &s) {
+    uint8_t frame[WS_MAX_FRAME];
+    LockGuard guard(lock_);
+    // Номер состояния растёт при каждом изменении, даже без подписчиков
+    if (s.diff(last_) != 0) {
+      seq_++;
+      const size_t len = count_ != 0 ? ws_encode_delta(frame, seq_, seq_ - 1, s, last_) : 0;
+      for (auto &c : clients_) {
+        if (len != 0 && c.fd >= 0 && c.subscribed && !c.fresh) send_(c, frame, len);
+      }
+    }
+    last_ = s;
+    if (!has_fresh_) return;
+    has_fresh_ = false;
+    const size_t len = ws_encode_state(frame, seq_, s);
+    for (auto &c : clients_) {
+      if (c.fd < 0 || !c.fresh) continue;
+      c.fresh = false;
+      send_(c, frame, len);
+    }
+  }
+
+  uint32_t frames_in() const { return frames_in_; }
+  uint32_t frames_out() const { return frames_out_; }
+  uint32_t bytes_out() const { return bytes_out_; }
+  uint32_t rejected() const { return rejected_; }
+
+ protected:
+  struct Client {
+    int fd{-1};
+    bool subscribed{false};
+    bool fresh{false};  // ждёт полный снимок
+  };
+
+  static esp_err_t on_frame_(httpd_req_t *req) {
+    auto *self = static_cast<WsServer *>(req->user_ctx);
+    // Первый вызов — рукопожатие
+    if (req->method == HTTP_GET) return self->accept_(httpd_req_to_sockfd(req)) ? ESP_OK : ESP_FAIL;
+
+    uint8_t buf[WS_MAX_FRAME];
+    httpd_ws_frame_t pkt = {};
+    if (httpd_ws_recv_frame(req, &pkt, 0) != ESP_OK) return ESP_FAIL;
+    // Нагрузку каждого кадра нужно дочитать, иначе следующий заголовок разбирается из её
+    // середины. Кадр больше буфера не бывает в протоколе: закрытие с 1009 (message too big)
+    if (pkt.len > sizeof(buf)) {
+      static const uint8_t TOO_BIG[2] = {0x03, 0xF1};
+      httpd_ws_frame_t close = {};
+      close.final = true;
+      close.type = HTTPD_WS_TYPE_CLOSE;
+      close.payload = const_cast<uint8_t *>(TOO_BIG);
+      close.len = sizeof(TOO_BIG);
+      httpd_ws_send_frame(req, &close);
+      return ESP_FAIL;
+    }
+    pkt.payload = buf;
+    if (pkt.len != 0 && httpd_ws_recv_frame(req, &pkt, pkt.len) != ESP_OK) return ESP_FAIL;
+    if (pkt.type != HTTPD_WS_TYPE_BINARY) return ESP_OK;  // текстовый кадр прочитан и отброшен
+    self->frames_in_++;
+
+    uint16_t seq = 0;
+    const WsStatus status = self->handle_(httpd_req_to_sockfd(req), buf, pkt.len, &seq);
+    uint8_t ack[4];
+    httpd_ws_frame_t out = {};
+    out.final = true;
+    out.type = HTTPD_WS_TYPE_BINARY;
+    out.payload = ack;
+    out.len = ws_encode_ack(ack, seq, status);
+    return httpd_ws_send_frame(req, &out);
+  }
+
+  WsStatus handle_(int fd, const uint8_t *data, size_t len, uint16_t *seq) {
+    if (len < WS_REQUEST_HEADER) return WS_BAD_FRAME;
+    *seq = get_u16_le(data + 1);
+    const uint8_t op = data[0];
+    if (op == WS_OP_COMMAND) {
+      Command cmd;
+      const WsStatus status = ws_decode_command(data + WS_REQUEST_HEADER, len - WS_REQUEST_HEADER, &cmd);
+      if (status != WS_OK || !on_command_) return status;
+      return on_command_(cmd);
+    }
+    if (len != WS_REQUEST_HEADER) return WS_BAD_FRAME;
+    LockGuard guard(lock_);
+    Client *c = find_(fd);
+    if (c == nullptr) return WS_BAD_FRAME;
+    switch (op) {
+      case WS_OP_SUBSCRIBE:
+        c->subscribed = true;
+        c->fresh = true;
+        has_fresh_ = true;
+        return WS_OK;
+      case WS_OP_UNSUBSCRIBE:
+        c->subscribed = false;
+        return WS_OK;
+      case WS_OP_GET_STATE:
+        c->fresh = true;
+        has_fresh_ = true;
+        return WS_OK;
+      default:
+        return WS_BAD_FRAME;
+    }
+  }
+
+  bool accept_(int fd) {
+    LockGuard guard(lock_);
+    for (uint8_t i = 0; i < max_clients_; i++) {
+      if (clients_[i].fd >= 0) continue;
+      clients_[i] = Client{};
+      clients_[i].fd = fd;
+      count_++;
+      return true;
+    }
+    rejected_++;
+    return false;
+  }
+
+  // close_fn отвечает и за закрытие сокета
+  static void on_close_(httpd_handle_t hd, int fd) {
+    auto *self = static_cast<WsServer *>(httpd_get_global_user_ctx(hd));
+    {
+      LockGuard guard(self->lock_);
+      Client *c = self->find_(fd);
+      if (c != nullptr) {
+        c->fd = -1;
+        self->count_--;
+      }
+    }
+    close(fd);
+  }
+
+  Client *find_(int fd) {
+    for (auto &c : clients_) {
+      if (c.fd == fd) return &c;
+    }
+    return nullptr;
+  }
+
+  // Вызывается под lock_
+  void send_(Client &c, const uint8_t *data, size_t len) {
+    httpd_ws_frame_t pkt = {};
+    pkt.final = true;
+    pkt.type = HTTPD_WS_TYPE_BINARY;
+    pkt.payload = const_cast<uint8_t *>(data);
+    pkt.len = len;
+    if (httpd_ws_send_frame_async(hd_, c.fd, &pkt) != ESP_OK) {
+      // Слот освободится в on_close_
+      httpd_sess_trigger_close(hd_, c.fd);
+      return;
+    }
+    frames_out_++;
+    bytes_out_ += len;
+  }
+
+  httpd_handle_t hd_{nullptr};
+  uint16_t port_{81};
+  uint8_t max_clients_{3};
+  CommandHandler on_command_;
+
+  Client clients_[MAX_CLIENTS];
+  Mutex lock_;
+  std::atomic<uint8_t> count_{0};
+  std::atomic<bool> has_fresh_{false};
+  StateSnapshot last_;
+  uint32_t seq_{0};
+
+  std::atomic<uint32_t> frames_in_{0};
+  uint32_t frames_out_{0};
+  uint32_t bytes_out_{0};
+  std::atomic<uint32_t> rejected_{0};
+};
+
+}  // namespace hydroponic_controller
+}  // namespace esphome
+
+#endif  // USE_HYDRO_WS
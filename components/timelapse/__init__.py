@@ -0,0 +1,64 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import esp32_camera, time
+from esphome.const import CONF_ID, CONF_TIME_ID
+
+DEPENDENCIES = ["esp32_camera", "web_server_base"]
+AUTO_LOAD = ["network", "time"]
+CODEOWNERS = ["@hydroponic"]
+
+CONF_CAMERA_ID = "camera_id"
+CONF_CAPTURE_INTERVAL = "capture_interval"
+CONF_LIGHT_ON = "light_on"
+CONF_LIGHT_OFF = "light_off"
+CONF_TOWER_HOST = "tower_host"
+CONF_KEEP_DAYS = "keep_days"
+CONF_WRITE_CHUNK = "write_chunk"
+
+timelapse_ns = cg.esphome_ns.namespace("timelapse")
+Timelapse = timelapse_ns.class_("Timelapse", cg.Component)
+
+
+# "HH:MM" -> минуты суток, как light_sched_on/off у hydroponic_controller
+def time_of_day_minutes(value):
+    value = cv.string_strict(value)
+    hours, sep, minutes = value.partition(":")
+    if not sep or not hours.isdigit() or not minutes.isdigit():
+        raise cv.Invalid(f"expected HH:MM, got {value}")
+    hours, minutes = int(hours), int(minutes)
+    if hours > 23 or minutes > 59:
+        raise cv.Invalid(f"{value} is not a time of day")
+    return hours * 60 + minutes
+
+
+CONFIG_SCHEMA = cv.Schema({
+    cv.GenerateID(): cv.declare_id(Timelapse),
+    cv.GenerateID(CONF_CAMERA_ID): cv.use_id(esp32_camera.ESP32Camera),
+    cv.Required(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+    cv.Optional(CONF_CAPTURE_INTERVAL, default="10min"): cv.All(
+        cv.positive_time_period_seconds,
+        cv.Range(min=cv.TimePeriod(seconds=10), max=cv.TimePeriod(hours=24)),
+    ),
+    # Окно съёмки; с tower_host заменяется расписанием света канала 0 башни
+    cv.Optional(CONF_LIGHT_ON, default="18:00"): time_of_day_minutes,
+    cv.Optional(CONF_LIGHT_OFF, default="09:00"): time_of_day_minutes,
+    cv.Optional(CONF_TOWER_HOST): cv.string_strict,
+    cv.Optional(CONF_KEEP_DAYS, default=30): cv.int_range(min=0, max=3650),
+    cv.Optional(CONF_WRITE_CHUNK, default=16384): cv.int_range(min=1024, max=65536),
+}).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    camera = await cg.get_variable(config[CONF_CAMERA_ID])
+    cg.add(var.set_camera(camera))
+    clock = await cg.get_variable(config[CONF_TIME_ID])
+    cg.add(var.set_clock(clock))
+    cg.add(var.set_capture_interval(config[CONF_CAPTURE_INTERVAL]))
+    cg.add(var.set_window(config[CONF_LIGHT_ON], config[CONF_LIGHT_OFF]))
+    if CONF_TOWER_HOST in config:
+        cg.add(var.set_tower_host(config[CONF_TOWER_HOST]))
+    cg.add(var.set_keep_days(config[CONF_KEEP_DAYS]))
+    cg.add(var.set_write_chunk(config[CONF_WRITE_CHUNK]))
@@ -0,0 +1,498 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esphome/components/esp32_camera/esp32_camera.h"
+#include "esphome/components/network/util.h"
+#include "esphome/components/time/real_time_clock.h"
+#include "esphome/components/web_server_base/web_server_base.h"
+#include "esphome/components/web_server_idf/web_server_idf.h"
+#include "timelapse_format.h"
+
+#include <driver/sdmmc_host.h>
+#include <esp_http_client.h>
+#include <esp_vfs_fat.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <sdmmc_cmd.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace esphome {
+namespace timelapse {
+
+static const char *const TAG = "timelapse";
+
+static const char *const MOUNT_POINT = "/sdcard";
+// Имена 8.3: в сборках ESP-IDF длинные имена FATFS по умолчанию выключены
+static const char *const FRAME_DIR = "/sdcard/tl";
+static const uint32_t CAPTURE_TIMEOUT_MS = 5000;
+static const uint32_t TOWER_POLL_MS = 10 * 60 * 1000UL;
+static const uint32_t TOWER_TASK_STACK = 6144;
+
+class Handler;
+
+class Timelapse : public Component {
+ public:
+  void set_camera(esp32_camera::ESP32Camera *camera) { camera_ = camera; }
+  void set_clock(time::RealTimeClock *clock) { clock_ = clock; }
+  void set_capture_interval(uint32_t seconds) { interval_s_ = seconds; }
+  void set_window(int on_minutes, int off_minutes) {
+    on_minutes_ = on_minutes;
+    off_minutes_ = off_minutes;
+  }
+  void set_tower_host(const std::string &host) { tower_host_ = host; }
+  void set_keep_days(uint16_t days) { keep_days_ = days; }
+  void set_write_chunk(uint32_t bytes) { write_chunk_ = bytes; }
+
+  void setup() override;
+
+  void loop() override {
+    const uint32_t now = millis();
+    if (pending_ != nullptr) {
+      write_chunk_step_();
+      return;
+    }
+    if (requested_ && now - requested_ms_ > CAPTURE_TIMEOUT_MS) {
+      requested_ = false;
+      errors_++;
+      ESP_LOGW(TAG, "✗ Camera did not deliver a frame");
+    }
+    // Окно с башни: сразу после подключения к сети, затем раз в TOWER_POLL_MS
+    if (!tower_host_.empty() && network::is_connected() && !tower_polling_ &&
+        (!tower_polled_ || now - tower_polled_ms_ > TOWER_POLL_MS))
+      start_tower_poll_();
+    apply_tower_window_();
+    // Проверка расписания раз в секунду
+    if (requested_ || now - checked_ms_ < 1000) return;
+    checked_ms_ = now;
+    check_schedule_();
+  }
+
+  void dump_config() override {
+    ESP_LOGCONFIG(TAG, "Timelapse:");
+    ESP_LOGCONFIG(TAG, "  Storage: %s, %s", FRAME_DIR, is_failed() ? "✗ SD card not mounted" : "✓ mounted");
+    ESP_LOGCONFIG(TAG, "  Window: %02d:%02d - %02d:%02d%s, every %u s", on_minutes_ / 60, on_minutes_ % 60,
+                  off_minutes_ / 60, off_minutes_ % 60, tower_host_.empty() ? "" : " (from tower)", interval_s_);
+    if (!tower_host_.empty()) ESP_LOGCONFIG(TAG, "  Tower: %s", tower_host_.c_str());
+    ESP_LOGCONFIG(TAG, "  Keep: %u days, write chunk %u bytes", keep_days_, write_chunk_);
+    ESP_LOGCONFIG(TAG, "  Frames: %u captured, %u errors", frames_, errors_);
+  }
+
+  void on_shutdown() override { close_day_(); }
+
+ protected:
+  bool mount_() {
+    sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+    sdmmc_slot_config_t slot = SDMMC_SLOT_CONFIG_DEFAULT();
+    // 1-битный режим: GPIO4 (DAT1) на ESP32-CAM занят вспышкой
+    slot.width = 1;
+    esp_vfs_fat_sdmmc_mount_config_t mount = {};
+    mount.format_if_mount_failed = false;
+    mount.max_files = 6;
+    mount.allocation_unit_size = 16 * 1024;
+    const esp_err_t err = esp_vfs_fat_sdmmc_mount(MOUNT_POINT, &host, &slot, &mount, &card_);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "✗ SD card mount failed: %s", esp_err_to_name(err));
+      return false;
+    }
+    ESP_LOGI(TAG, "✓ SD card mounted, %llu MB", ((uint64_t) card_->csd.capacity) * card_->csd.sector_size >> 20);
+    return true;
+  }
+
+  // Кадр в начале окна и далее каждые interval_s_, с фазой от начала окна
+  void check_schedule_() {
+    const auto time = clock_->now();
+    if (!time.is_valid()) return;
+    const int minutes = time.hour * 60 + time.minute;
+    if (!window_contains(on_minutes_, off_minutes_, minutes)) return;
+    const uint32_t since_on = ((minutes - on_minutes_ + 1440) % 1440) * 60 + time.second;
+    const uint32_t slot = since_on / interval_s_;
+    uint32_t ts = time.timestamp;
+    if (window_belongs_to_previous_day(on_minutes_, off_minutes_, minutes)) ts -= 86400;
+    char day[9];
+    day_name_(ts, day);
+    if (slot == last_slot_ && strcmp(day, last_slot_day_) == 0) return;
+    last_slot_ = slot;
+    memcpy(last_slot_day_, day, sizeof(day));
+    memcpy(request_day_, day, sizeof(day));
+    request_ts_ = time.timestamp;
+    requested_ = true;
+    requested_ms_ = millis();
+    camera_->request_image(esp32_camera::IDLE);
+  }
+
+  void on_image_(std::shared_ptr<esp32_camera::CameraImage> image) {
+    if (!requested_ || pending_ != nullptr || !image->was_requested_by(esp32_camera::IDLE)) return;
+    requested_ = false;
+    if (!open_day_(request_day_)) {
+      errors_++;
+      return;
+    }
+    pending_ = std::move(image);
+    pending_offset_ = data_size_;
+    written_ = 0;
+  }
+
+  // Кадр пишется из буфера камеры частями по write_chunk_, чтобы не держать loop()
+  void write_chunk_step_() {
+    const uint8_t *buf = pending_->get_data_buffer();
+    const size_t len = pending_->get_data_length();
+    const size_t n = std::min<size_t>(write_chunk_, len - written_);
+    const size_t done = fwrite(buf + written_, 1, n, data_);
+    written_ += done;
+    data_size_ += done;
+    if (done != n) {
+      ESP_LOGE(TAG, "✗ Frame write failed after %u of %u bytes", (unsigned) written_, (unsigned) len);
+      errors_++;
+      pending_.reset();
+      return;
+    }
+    if (written_ < len) return;
+    pending_.reset();  // буфер возвращается камере
+
+    // Индекс — только после того, как кадр на карте
+    fsync(fileno(data_));
+    uint8_t rec[INDEX_RECORD_SIZE];
+    encode_record({pending_offset_, (uint32_t) len, request_ts_}, rec);
+    if (fwrite(rec, 1, sizeof(rec), index_) != sizeof(rec) || fflush(index_) != 0) {
+      ESP_LOGE(TAG, "✗ Index write failed");
+      errors_++;
+      // Обрывок записи сдвинул бы все следующие: индекс обрезается до последней целой
+      // записи после закрытия (stdio дописывает буфер при fclose), день переоткрывается
+      // со следующим кадром
+      char path[32];
+      day_path_(open_day_name_, "idx", path, sizeof(path));
+      close_day_();
+      truncate(path, index_size_);
+      return;
+    }
+    fsync(fileno(index_));
+    frames_++;
+    ESP_LOGD(TAG, "Frame %s #%u: %u bytes at %u", open_day_name_, (unsigned) (index_size_ / INDEX_RECORD_SIZE),
+             (unsigned) len, (unsigned) pending_offset_);
+    index_size_ += sizeof(rec);
+  }
+
+  bool open_day_(const char *day) {
+    if (data_ != nullptr && strcmp(day, open_day_name_) == 0) return true;
+    close_day_();
+    char path[32];
+    day_path_(day, "jpg", path, sizeof(path));
+    data_ = fopen(path, "ab");
+    day_path_(day, "idx", path, sizeof(path));
+    // Хвост оборванной записи индекса отрезается, иначе следующие записи сдвинутся
+    struct stat st;
+    if (stat(path, &st) == 0 && st.st_size % INDEX_RECORD_SIZE != 0)
+      truncate(path, st.st_size - st.st_size % INDEX_RECORD_SIZE);
+    index_ = fopen(path, "ab");
+    if (data_ == nullptr || index_ == nullptr) {
+      ESP_LOGE(TAG, "✗ Cannot open %s", path);
+      close_day_();
+      return false;
+    }
+    // Без буфера stdio: fwrite идёт из буфера камеры прямо в драйвер FATFS
+    setvbuf(data_, nullptr, _IONBF, 0);
+    data_size_ = fstat(fileno(data_), &st) == 0 ? st.st_size : 0;
+    index_size_ = fstat(fileno(index_), &st) == 0 ? st.st_size : 0;
+    memcpy(open_day_name_, day, sizeof(open_day_name_));
+    ESP_LOGI(TAG, "Day %s: %u frames, %u bytes", day, (unsigned) (index_size_ / INDEX_RECORD_SIZE),
+             (unsigned) data_size_);
+    prune_();
+    return true;
+  }
+
+  void close_day_() {
+    if (data_ != nullptr) fclose(data_);
+    if (index_ != nullptr) fclose(index_);
+    data_ = index_ = nullptr;
+    open_day_name_[0] = '\0';
+  }
+
+  // Удаляет дни старше keep_days_ от открытого дня
+  void prune_() {
+    if (keep_days_ == 0) return;
+    char cutoff[9];
+    day_name_(request_ts_ - keep_days_ * 86400u, cutoff);
+    DIR *dir = opendir(FRAME_DIR);
+    if (dir == nullptr) return;
+    struct dirent *e;
+    char path[32];
+    while ((e = readdir(dir)) != nullptr) {
+      const char *dot = strchr(e->d_name, '.');
+      if (dot == nullptr || !is_day_name(e->d_name, dot - e->d_name) || strncmp(e->d_name, cutoff, 8) >= 0) continue;
+      snprintf(path, sizeof(path), "%s/%s", FRAME_DIR, e->d_name);
+      unlink(path);
+      ESP_LOGI(TAG, "Removed %s", path);
+    }
+    closedir(dir);
+  }
+
+  // Запрос к башне (DNS, соединение, чтение) идёт в отдельной задаче, loop() сеть не ждёт
+  void start_tower_poll_() {
+    tower_polled_ = true;
+    tower_polled_ms_ = millis();
+    tower_polling_ = true;
+    if (xTaskCreate(Timelapse::tower_task_, "tl_tower", TOWER_TASK_STACK, this, 1, nullptr) != pdPASS) {
+      tower_polling_ = false;
+      ESP_LOGW(TAG, "✗ Cannot start tower poll task");
+    }
+  }
+
+  static void tower_task_(void *arg) {
+    auto *self = static_cast<Timelapse *>(arg);
+    int on, off;
+    if (self->fetch_tower_window_(&on, &off)) self->tower_window_ = (on << 16) | off;
+    self->tower_polling_ = false;
+    vTaskDelete(nullptr);
+  }
+
+  // Окно света канала 0 с башни; вызывается в задаче опроса
+  bool fetch_tower_window_(int *on, int *off) const {
+    char url[96];
+    snprintf(url, sizeof(url), "http://%s/api/state", tower_host_.c_str());
+    esp_http_client_config_t config = {};
+    config.url = url;
+    config.timeout_ms = 1000;
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    char buf[1024];
+    int len = -1;
+    if (esp_http_client_open(client, 0) == ESP_OK && esp_http_client_fetch_headers(client) >= 0)
+      len = esp_http_client_read_response(client, buf, sizeof(buf) - 1);
+    esp_http_client_cleanup(client);
+    if (len <= 0) {
+      ESP_LOGW(TAG, "✗ Tower %s unreachable, keeping window", tower_host_.c_str());
+      return false;
+    }
+    buf[len] = '\0';
+    return parse_light_window(buf, on, off);
+  }
+
+  // Результат опроса применяется в loop(); при ошибке остаётся прежнее окно
+  void apply_tower_window_() {
+    const int32_t window = tower_window_.exchange(-1);
+    if (window < 0) return;
+    const int on = window >> 16, off = window & 0xFFFF;
+    if (on != on_minutes_ || off != off_minutes_)
+      ESP_LOGI(TAG, "Window from tower: %02d:%02d - %02d:%02d", on / 60, on % 60, off / 60, off % 60);
+    on_minutes_ = on;
+    off_minutes_ = off;
+  }
+
+  void day_name_(uint32_t ts, char *out) const {
+    const auto t = ESPTime::from_epoch_local(ts);
+    snprintf(out, 9, "%04u%02u%02u", t.year, t.month, t.day_of_month);
+  }
+  static void day_path_(const char *day, const char *ext, char *out, size_t size) {
+    snprintf(out, size, "%s/%s.%s", FRAME_DIR, day, ext);
+  }
+
+  esp32_camera::ESP32Camera *camera_{nullptr};
+  time::RealTimeClock *clock_{nullptr};
+  sdmmc_card_t *card_{nullptr};
+  uint32_t interval_s_{600};
+  int on_minutes_{1080};  // 18:00, как у расписания света башни по умолчанию
+  int off_minutes_{540};  // 09:00
+  std::string tower_host_;
+  uint16_t keep_days_{30};
+  uint32_t write_chunk_{16384};
+
+  uint32_t checked_ms_{0};
+  bool tower_polled_{false};
+  uint32_t tower_polled_ms_{0};
+  std::atomic<bool> tower_polling_{false};
+  std::atomic<int32_t> tower_window_{-1};  // on << 16 | off из задачи опроса, -1 — нет нового
+  uint32_t last_slot_{UINT32_MAX};
+  char last_slot_day_[9]{};
+  bool requested_{false};
+  uint32_t requested_ms_{0};
+  uint32_t request_ts_{0};
+  char request_day_[9]{};
+
+  std::shared_ptr<esp32_camera::CameraImage> pending_;
+  uint32_t pending_offset_{0};
+  size_t written_{0};
+
+  FILE *data_{nullptr};
+  FILE *index_{nullptr};
+  char open_day_name_[9]{};
+  uint32_t data_size_{0};
+  uint32_t index_size_{0};
+
+  uint32_t frames_{0};
+  uint32_t errors_{0};
+
+  friend class Handler;
+};
+
+// /timelapse                  — список дней: {"days":[{"day":"YYYYMMDD","frames":n,"bytes":n},...],...}
+// /timelapse/<день>.jpg       — все кадры дня подряд (Range)
+// /timelapse/<день>.idx       — индекс дня, 12 байт на кадр (Range)
+// /timelapse/<день>/<n>       — один кадр, n от 0; -1 — последний (Range внутри кадра)
+class Handler : public AsyncWebHandler {
+ public:
+  Handler(Timelapse *owner) : owner_(owner) {}
+
+  bool canHandle(AsyncWebServerRequest *req) const override {
+    const char *uri = static_cast<httpd_req_t *>(*req)->uri;
+    return req->method() == HTTP_GET && strncmp(uri, "/timelapse", 10) == 0 &&
+           (uri[10] == '\0' || uri[10] == '/' || uri[10] == '?');
+  }
+
+  void handleRequest(AsyncWebServerRequest *req) override {
+    const char *uri = static_cast<httpd_req_t *>(*req)->uri;
+    const char *p = uri + 10;
+    const size_t len = strcspn(p, "?");
+    if (len == 0 || (len == 1 && *p == '/')) return send_days_(req);
+    p++;  // '/'
+    if (len < 10 || !is_day_name(p, 8)) return reply_(req, 404, "{\"error\":\"not found\"}");
+    char day[9];
+    memcpy(day, p, 8);
+    day[8] = '\0';
+    char path[32];
+    const char *rest = p + 8;
+    const size_t rest_len = len - 9;
+    if (rest_len == 4 && (strncmp(rest, ".jpg", 4) == 0 || strncmp(rest, ".idx", 4) == 0)) {
+      Timelapse::day_path_(day, rest[1] == 'j' ? "jpg" : "idx", path, sizeof(path));
+      struct stat st;
+      if (stat(path, &st) != 0) return reply_(req, 404, "{\"error\":\"no such day\"}");
+      return send_file_(req, path, 0, st.st_size, "application/octet-stream");
+    }
+    if (rest_len >= 2 && rest[0] == '/') return send_frame_(req, day, atoi(rest + 1));
+    reply_(req, 404, "{\"error\":\"not found\"}");
+  }
+
+ protected:
+  void send_days_(AsyncWebServerRequest *req) {
+    httpd_req_t *r = *req;
+    httpd_resp_set_type(r, "application/json");
+    httpd_resp_set_hdr(r, "Cache-Control", "no-cache");
+    char line[128];
+    int n = snprintf(line, sizeof(line), "{\"window\":{\"on\":%d,\"off\":%d},\"interval\":%u,\"frames\":%u,"
+                     "\"errors\":%u,\"days\":[", owner_->on_minutes_, owner_->off_minutes_,
+                     (unsigned) owner_->interval_s_, (unsigned) owner_->frames_, (unsigned) owner_->errors_);
+    httpd_resp_send_chunk(r, line, n);
+    DIR *dir = opendir(FRAME_DIR);
+    const char *sep = "";
+    struct dirent *e;
+    while (dir != nullptr && (e = readdir(dir)) != nullptr) {
+      if (strlen(e->d_name) != 12 || strcmp(e->d_name + 8, ".idx") != 0 || !is_day_name(e->d_name, 8)) continue;
+      char day[9], path[32];
+      memcpy(day, e->d_name, 8);
+      day[8] = '\0';
+      struct stat idx, data;
+      Timelapse::day_path_(day, "idx", path, sizeof(path));
+      if (stat(path, &idx) != 0) continue;
+      Timelapse::day_path_(day, "jpg", path, sizeof(path));
+      if (stat(path, &data) != 0) data.st_size = 0;
+      n = snprintf(line, sizeof(line), "%s{\"day\":\"%s\",\"frames\":%u,\"bytes\":%u}", sep, day,
+                   (unsigned) (idx.st_size / INDEX_RECORD_SIZE), (unsigned) data.st_size);
+      httpd_resp_send_chunk(r, line, n);
+      sep = ",";
+    }
+    if (dir != nullptr) closedir(dir);
+    httpd_resp_send_chunk(r, "]}", 2);
+    httpd_resp_send_chunk(r, nullptr, 0);
+  }
+
+  void send_frame_(AsyncWebServerRequest *req, const char *day, int n) {
+    char path[32];
+    Timelapse::day_path_(day, "idx", path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr) return reply_(req, 404, "{\"error\":\"no such day\"}");
+    struct stat st;
+    const uint32_t count = fstat(fileno(f), &st) == 0 ? st.st_size / INDEX_RECORD_SIZE : 0;
+    if (n < 0) n += count;
+    uint8_t rec[INDEX_RECORD_SIZE];
+    const bool found = n >= 0 && (uint32_t) n < count && fseek(f, n * INDEX_RECORD_SIZE, SEEK_SET) == 0 &&
+                       fread(rec, 1, sizeof(rec), f) == sizeof(rec);
+    fclose(f);
+    if (!found) return reply_(req, 404, "{\"error\":\"no such frame\"}");
+    const IndexRecord frame = decode_record(rec);
+    char ts[12];
+    snprintf(ts, sizeof(ts), "%u", (unsigned) frame.ts);
+    httpd_resp_set_hdr(*req, "X-Timestamp", ts);
+    // Кадры не меняются: можно кэшировать
+    httpd_resp_set_hdr(*req, "Cache-Control", "max-age=31536000, immutable");
+    Timelapse::day_path_(day, "jpg", path, sizeof(path));
+    send_file_(req, path, frame.offset, frame.length, "image/jpeg");
+  }
+
+  // Отрезок [base, base + size) файла как отдельный ресурс с поддержкой Range
+  void send_file_(AsyncWebServerRequest *req, const char *path, uint32_t base, uint32_t size, const char *type) {
+    httpd_req_t *r = *req;
+    char range[48], header[48];
+    uint32_t first = 0, last = size == 0 ? 0 : size - 1;
+    RangeResult result = RANGE_NONE;
+    if (httpd_req_get_hdr_value_str(r, "Range", range, sizeof(range)) == ESP_OK)
+      result = parse_range(range, size, &first, &last);
+    httpd_resp_set_hdr(r, "Accept-Ranges", "bytes");
+    if (result == RANGE_UNSATISFIABLE) {
+      snprintf(header, sizeof(header), "bytes */%u", (unsigned) size);
+      httpd_resp_set_status(r, "416 Range Not Satisfiable");
+      httpd_resp_set_hdr(r, "Content-Range", header);
+      httpd_resp_send(r, nullptr, 0);
+      return;
+    }
+    if (result == RANGE_OK) {
+      snprintf(header, sizeof(header), "bytes %u-%u/%u", (unsigned) first, (unsigned) last, (unsigned) size);
+      httpd_resp_set_status(r, "206 Partial Content");
+      httpd_resp_set_hdr(r, "Content-Range", header);
+    }
+    httpd_resp_set_type(r, type);
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr || fseek(f, base + first, SEEK_SET) != 0) {
+      if (f != nullptr) fclose(f);
+      httpd_resp_set_status(r, "500 Internal Server Error");
+      httpd_resp_send(r, nullptr, 0);
+      return;
+    }
+    uint32_t left = size == 0 ? 0 : last - first + 1;
+    while (left > 0) {
+      const size_t n = fread(buf_, 1, std::min<uint32_t>(left, sizeof(buf_)), f);
+      if (n == 0 || httpd_resp_send_chunk(r, reinterpret_cast<const char *>(buf_), n) != ESP_OK) break;
+      left -= n;
+    }
+    fclose(f);
+    httpd_resp_send_chunk(r, nullptr, 0);
+  }
+
+  static void reply_(AsyncWebServerRequest *req, int code, const char *content) {
+    req->send(code, "application/json", content);
+  }
+
+  Timelapse *owner_;
+  // Запросы обрабатываются в одной задаче httpd
+  uint8_t buf_[4096];
+};
+
+// Implementations
+inline void Timelapse::setup() {
+  ESP_LOGI(TAG, ">>> Setting up Timelapse...");
+  if (!mount_()) {
+    mark_failed();
+    return;
+  }
+  mkdir(FRAME_DIR, 0775);
+  // Кадр приходит в loop() камеры; буфер удерживается shared_ptr, пока не записан
+  camera_->add_image_callback([this](std::shared_ptr<esp32_camera::CameraImage> image) { on_image_(image); });
+  if (web_server_base::global_web_server_base != nullptr) {
+    web_server_base::global_web_server_base->add_handler(new Handler(this));
+  } else {
+    ESP_LOGE(TAG, "Web Server Base not initialized!");
+  }
+  ESP_LOGI(TAG, ">>> Timelapse setup complete!");
+}
+
+}  // namespace timelapse
+}  // namespace esphome
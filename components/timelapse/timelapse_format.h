@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace esphome {
+namespace timelapse {
+
+// Контейнер дня — два файла только для дописывания:
+//   <день>.jpg — JPEG-кадры подряд, байты как есть из буфера камеры
+//   <день>.idx — по записи на кадр, little-endian:
+//     u32 offset  смещение кадра в .jpg
+//     u32 length  длина кадра
+//     u32 ts      время съёмки, unix
+// Запись индекса пишется после кадра: кадр без записи (сбой питания) просто не виден.
+static const size_t INDEX_RECORD_SIZE = 12;
+
+struct IndexRecord {
+  uint32_t offset;
+  uint32_t length;
+  uint32_t ts;
+};
+
+inline void put_u32_le(uint8_t *p, uint32_t v) {
+  for (uint8_t i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+inline uint32_t get_u32_le(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24); }
+
+inline void encode_record(const IndexRecord &r, uint8_t *out) {
+  put_u32_le(out, r.offset);
+  put_u32_le(out + 4, r.length);
+  put_u32_le(out + 8, r.ts);
+}
+inline IndexRecord decode_record(const uint8_t *in) { return {get_u32_le(in), get_u32_le(in + 4), get_u32_le(in + 8)}; }
+
+// Окно света в минутах суток, как в расписании света башни: on == off — весь день,
+// on > off — окно через полночь
+inline bool window_contains(int on, int off, int minutes) {
+  if (on == off) return true;
+  if (on < off) return minutes >= on && minutes < off;
+  return minutes >= on || minutes < off;
+}
+
+// Кадры окна, переходящего через полночь, относятся ко дню его начала
+inline bool window_belongs_to_previous_day(int on, int off, int minutes) { return on > off && minutes < off; }
+
+// Окно канала 0 из /api/state башни: "light_sched":{"enabled":true,"on":1080,"off":540}.
+// false — поля нет или расписание выключено (окно не меняется)
+inline bool parse_light_window(const char *json, int *on, int *off) {
+  const char *p = strstr(json, "\"light_sched\":{");
+  if (p == nullptr || strncmp(p + 15, "\"enabled\":true", 14) != 0) return false;
+  const char *on_key = strstr(p, "\"on\":");
+  const char *off_key = strstr(p, "\"off\":");
+  if (on_key == nullptr || off_key == nullptr) return false;
+  char *end;
+  const long a = strtol(on_key + 5, &end, 10);
+  if (end == on_key + 5) return false;
+  const long b = strtol(off_key + 6, &end, 10);
+  if (end == off_key + 6) return false;
+  if (a < 0 || a > 1439 || b < 0 || b > 1439) return false;
+  *on = a;
+  *off = b;
+  return true;
+}
+
+enum RangeResult : uint8_t {
+  RANGE_NONE = 0,      // заголовка нет или он не поддерживается — отдать весь файл (200)
+  RANGE_OK,            // 206, [*first, *last]
+  RANGE_UNSATISFIABLE  // 416
+};
+
+// Один диапазон из заголовка Range: "bytes=a-b", "bytes=a-", "bytes=-n".
+// Несколько диапазонов не поддерживаются: отдаётся весь файл, как разрешает RFC 9110.
+inline RangeResult parse_range(const char *header, uint32_t size, uint32_t *first, uint32_t *last) {
+  if (header == nullptr || strncmp(header, "bytes=", 6) != 0) return RANGE_NONE;
+  const char *p = header + 6;
+  if (strchr(p, ',') != nullptr) return RANGE_NONE;
+  char *end;
+  if (*p == '-') {
+    const unsigned long n = strtoul(p + 1, &end, 10);
+    if (end == p + 1 || *end != '\0') return RANGE_NONE;
+    if (n == 0 || size == 0) return RANGE_UNSATISFIABLE;
+    *first = n >= size ? 0 : size - n;
+    *last = size - 1;
+    return RANGE_OK;
+  }
+  const unsigned long a = strtoul(p, &end, 10);
+  if (end == p || *end != '-') return RANGE_NONE;
+  p = end + 1;
+  unsigned long b = size == 0 ? 0 : size - 1;
+  if (*p != '\0') {
+    b = strtoul(p, &end, 10);
+    if (end == p || *end != '\0' || b < a) return RANGE_NONE;
+  }
+  if (a >= size) return RANGE_UNSATISFIABLE;
+  *first = a;
+  *last = b >= size ? size - 1 : b;
+  return RANGE_OK;
+}
+
+// Имя дня "YYYYMMDD" -> true, если это 8 цифр
+inline bool is_day_name(const char *s, size_t n) {
+  if (n != 8) return false;
+  for (size_t i = 0; i < n; i++) {
+    if (s[i] < '0' || s[i] > '9') return false;
+  }
+  return true;
+}
+
+}  // namespace timelapse
+}  // namespace esphome
@@ -0,0 +1,36 @@
+// Счётчик выделений памяти: malloc/calloc/realloc подменяются обёртками над
+// функциями glibc, operator new по умолчанию идёт через malloc и тоже учитывается.
+#include "alloc_count.h"
+
+#include <cstddef>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+}
+
+static thread_local uint64_t alloc_count = 0;
+
+extern "C" void *malloc(size_t size) {
+  alloc_count++;
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+  alloc_count++;
+  return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) {
+  alloc_count++;
+  return __libc_realloc(p, size);
+}
+
+namespace esphome {
+namespace host {
+
+uint64_t allocations() { return alloc_count; }
+
+}  // namespace host
+}  // namespace esphome
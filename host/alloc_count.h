@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace host {
+
+// Число вызовов malloc/calloc/realloc (а значит и operator new) в текущем потоке
+uint64_t allocations();
+
+}  // namespace host
+}  // namespace esphome
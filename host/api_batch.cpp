@@ -0,0 +1,51 @@
+// /api/batch через стенд-ин web_server_idf: тело формы читается сервером до
+// обработчика, поэтому значения должны приходить из getParam, а не из httpd_req_recv.
+#include "check.h"
+#include "sim.h"
+
+using namespace esphome;
+using namespace esphome::host;
+
+static bool contains(const std::string &text, const char *part) { return text.find(part) != std::string::npos; }
+
+int main() {
+  reset();
+  SimTower t(2, 1);
+  t.boot();
+
+  // Форма в теле, как от fetch(.., {body: URLSearchParams}) и curl -d
+  Response r = t.post("/api/batch", "ch=1&pump_on=1&pump_speed=40&pump_sched_on=7&pump_sched_off=21");
+  CHECK(r.status == 200, "form body: %d %s", r.status, r.body.c_str());
+  CHECK(t.pump(1).state && t.pump(1).speed == 40);
+  CHECK(contains(r.body, "\"sched\":{\"enabled\":false,\"on\":7,\"off\":21}"), "%s", r.body.c_str());
+
+  // Тело без Content-Type — тоже форма
+  r = t.post("/api/batch", "light_on=1&light_brightness=30", nullptr);
+  CHECK(r.status == 200, "untyped body: %d %s", r.status, r.body.c_str());
+  CHECK(t.light(0).current_values.is_on());
+
+  // Query-строка без тела
+  r = t.post("/api/batch?pump_on=0&ch=1");
+  CHECK(r.status == 200, "query: %d %s", r.status, r.body.c_str());
+  CHECK(!t.pump(1).state);
+
+  // Значение вне диапазона или не число отклоняет весь запрос до применения
+  r = t.post("/api/batch", "pump_on=1&pump_speed=101");
+  CHECK(r.status == 400 && contains(r.body, "\"key\":\"pump_speed\""), "%d %s", r.status, r.body.c_str());
+  CHECK(!t.pump(0).state, "rejected batch must not apply pump_on");
+  r = t.post("/api/batch", "light_sched_on=9am");
+  CHECK(r.status == 400 && contains(r.body, "\"key\":\"light_sched_on\""), "%d %s", r.status, r.body.c_str());
+
+  // Нечего применять; неизвестный канал
+  CHECK(t.post("/api/batch", "ch=1").status == 400);
+  CHECK(t.post("/api/batch", "speed=50").status == 400);
+  r = t.post("/api/batch", "ch=3&pump_on=1");
+  CHECK(r.status == 400 && contains(r.body, "unknown channel"), "%d %s", r.status, r.body.c_str());
+
+  // Изменения расписания из батча записываются одной записью
+  t.run(6000);
+  CHECK(flash.commits == 1, "%u flash commits", flash.commits);
+
+  printf("api batch: form body, query and validation ok\n");
+  return 0;
+}
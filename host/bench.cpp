@@ -0,0 +1,210 @@
+// Микробенчмарки горячих путей компонента на хосте: loop(), JSON состояния,
+// кодирование и запись настроек, чтение истории. Время на хосте не равно времени на ESP32, но
+// отношение к базовому прогону и число выделений памяти на операцию переносятся:
+//
+//   bench --save base.json
+//   bench --baseline base.json --max-regression 25
+#include "alloc_count.h"
+#include "check.h"
+#include "report.h"
+#include "sim.h"
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::hydroponic_controller;
+
+struct Result {
+  std::string name;
+  double ns_per_op;
+  double allocs_per_op;
+};
+
+// Повторяет op, пока не наберётся min_ms реального времени; выделения считаются отдельно
+static Result measure(const char *name, uint32_t min_ms, const std::function<void()> &op) {
+  for (int i = 0; i < 100; i++) op();
+  using clock = std::chrono::steady_clock;
+  uint64_t ops = 0, batch = 64;
+  const uint64_t allocs_before = allocations();
+  const auto start = clock::now();
+  auto elapsed = clock::duration::zero();
+  while (elapsed < std::chrono::milliseconds(min_ms)) {
+    for (uint64_t i = 0; i < batch; i++) op();
+    ops += batch;
+    batch *= 2;
+    elapsed = clock::now() - start;
+  }
+  const uint64_t allocs = allocations() - allocs_before;
+  const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+  return {name, ns / ops, (double) allocs / ops};
+}
+
+// Все каналы заняты, расписания включены — самый тяжёлый снимок и loop()
+static void configure(SimTower &t) {
+  for (uint8_t ch = 0; ch < MAX_CHANNELS; ch++) {
+    char uri[96];
+    snprintf(uri, sizeof(uri), "/api/batch?ch=%u&pump_sched_enabled=1&pump_sched_on=5&pump_sched_off=15", ch);
+    CHECK(t.post(uri).status == 200);
+    snprintf(uri, sizeof(uri), "/api/light-schedule?ch=%u&enabled=1&on=1080&off=540", ch);
+    CHECK(t.post(uri).status == 200);
+  }
+  t.run(6000);  // настройки записаны, правила взведены
+}
+
+static std::vector<Result> run_all(uint32_t min_ms) {
+  std::vector<Result> results;
+  reset();
+  SimTower t(MAX_CHANNELS, MAX_CHANNELS);
+  t.clock.sync(1772323200);
+  t.boot();
+  configure(t);
+  auto &c = t.controller;
+
+  // Итерация без дедлайнов: время почти стоит
+  results.push_back(measure("loop_idle", min_ms, [&] {
+    advance_us(10);
+    c.loop();
+  }));
+
+  // Подписчик SSE и смена состояния на каждой итерации: diff, JSON и отправка
+  CHECK(t.get("/api/events/stream").status == 200);
+  auto &sessions = t.web().get_server()->sessions;
+  bool on = false;
+  results.push_back(measure("loop_publish", min_ms, [&] {
+    on = !on;
+    t.pump(0).turn_on().set_speed(on ? 40 : 60).perform();
+    advance_us(10);
+    c.loop();
+    for (auto &s : sessions) s.second.sent.clear();
+  }));
+
+  results.push_back(measure("state_json", min_ms, [&] {
+    char buf[STATE_JSON_SIZE];
+    const size_t n = c.snapshot_().to_json(buf, sizeof(buf), FIELD_ALL);
+    CHECK(n > 0);
+  }));
+
+  // Через Handler со стенд-ином сервера: маршрут, параметры, ответ
+  results.push_back(measure("get_state", min_ms, [&] { CHECK(t.get("/api/state").status == 200); }));
+
+  PumpChannels pumps;
+  LightChannels lights;
+  for (uint8_t ch = 0; ch < MAX_CHANNELS; ch++) {
+    pumps.sched.add(true, 5 + ch, 15);
+    lights.sched.add(true, 1080, 540 + ch);
+  }
+  PackedSettings packed;
+  results.push_back(measure("settings_encode", min_ms, [&] { encode_settings(pumps.sched, lights.sched, &packed); }));
+  results.push_back(measure("settings_decode", min_ms, [&] {
+    ScheduleTable p, l;
+    for (uint8_t ch = 0; ch < MAX_CHANNELS; ch++) {
+      p.add(false, 0, 0);
+      l.add(false, 0, 0);
+    }
+    CHECK(decode_settings(packed, &p, &l));
+  }));
+
+  // Запись во флэш и пропуск по CRC — две ветки SettingsStore::flush()
+  SettingsStore<PackedSettings> store;
+  store.init(fnv1_hash("bench_settings"));
+  uint16_t value = 0;
+  auto encode = [&](PackedSettings *s) { encode_settings(pumps.sched, lights.sched, s); };
+  results.push_back(measure("settings_save", min_ms, [&] {
+    pumps.sched.on_minutes[0] = 1 + value++ % 120;
+    store.mark_dirty();
+    CHECK(store.flush(encode));
+  }));
+  results.push_back(measure("settings_save_unchanged", min_ms, [&] {
+    store.mark_dirty();
+    CHECK(store.flush(encode));
+  }));
+  results.push_back(measure("settings_load", min_ms, [&] {
+    PackedSettings loaded;
+    CHECK(store.load(&loaded));
+  }));
+
+  // Ряд целиком из кольца 256 КБ (1024 блока), как в /api/history?format=bin
+  HistoryStore history;
+  CHECK(history.init(262144));
+  for (uint32_t ts = 1; history.samples() < 200000; ts++) {
+    history.append(SERIES_PUMP, ts, (float) (ts % 100));
+    history.append(SERIES_LIGHT, ts, (float) (ts % 7));
+  }
+  results.push_back(measure("history_read", min_ms, [&] {
+    HistoryStore::Cursor cursor;
+    HistoryBlock block;
+    uint32_t blocks = 0;
+    while (history.copy_next(SERIES_PUMP, &cursor, 0, UINT32_MAX, &block)) blocks++;
+    CHECK(blocks > 0);
+  }));
+  return results;
+}
+
+// {"benchmarks":{"<имя>":{"ns_per_op":..,"allocs_per_op":..}}}, см. report.h
+static void save(const char *path, const std::vector<Result> &results) {
+  FILE *f = fopen(path, "w");
+  CHECK(f != nullptr, "cannot write %s", path);
+  fprintf(f, "{\"benchmarks\":{");
+  for (size_t i = 0; i < results.size(); i++) {
+    fprintf(f, "%s\n  \"%s\":{\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f}", i ? "," : "", results[i].name.c_str(),
+            results[i].ns_per_op, results[i].allocs_per_op);
+  }
+  fprintf(f, "\n}}\n");
+  fclose(f);
+}
+
+static void usage() {
+  fprintf(stderr, "usage: bench [--quick] [--save FILE] [--baseline FILE] [--max-regression PCT]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  uint32_t min_ms = 300;
+  const char *save_path = nullptr, *baseline_path = nullptr;
+  double max_regression = -1;
+  for (int i = 1; i < argc; i++) {
+    const bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--quick") == 0) {
+      min_ms = 10;
+    } else if (strcmp(argv[i], "--save") == 0 && has_value) {
+      save_path = argv[++i];
+    } else if (strcmp(argv[i], "--baseline") == 0 && has_value) {
+      baseline_path = argv[++i];
+    } else if (strcmp(argv[i], "--max-regression") == 0 && has_value) {
+      max_regression = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  const std::vector<Result> results = run_all(min_ms);
+  const std::string baseline = baseline_path != nullptr ? read_file(baseline_path) : std::string();
+  std::vector<std::string> regressions;
+  printf("%-24s %10s %10s %8s %8s\n", "benchmark", "ns/op", "allocs/op", "d ns", "d alloc");
+  for (const auto &r : results) {
+    printf("%-24s %10.1f %10.3f", r.name.c_str(), r.ns_per_op, r.allocs_per_op);
+    double base_ns, base_allocs;
+    if (!baseline.empty() && report_value(baseline, r.name, "ns_per_op", &base_ns) &&
+        report_value(baseline, r.name, "allocs_per_op", &base_allocs)) {
+      const double d_ns = delta_pct(r.ns_per_op, base_ns);
+      printf(" %+7.1f%% %+8.3f", d_ns, r.allocs_per_op - base_allocs);
+      // Новое выделение памяти на горячем пути — регрессия при любом пороге
+      if (max_regression >= 0 && (d_ns > max_regression || r.allocs_per_op > base_allocs + 0.01))
+        regressions.push_back(r.name);
+    }
+    printf("\n");
+  }
+  if (save_path != nullptr) save(save_path, results);
+  if (!regressions.empty()) {
+    fprintf(stderr, "regression vs baseline:");
+    for (const auto &name : regressions) fprintf(stderr, " %s", name.c_str());
+    fprintf(stderr, "\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+// Проверки хостовых тестов: сообщение с местом и значениями, выход с кодом 1
+#define CHECK(cond, ...) \
+  do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed", __FILE__, __LINE__, #cond); \
+      esphome::host::check_detail("" __VA_ARGS__); \
+      exit(1); \
+    } \
+  } while (0)
+
+namespace esphome {
+namespace host {
+
+inline void check_detail(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  if (*fmt != '\0') {
+    fputs(": ", stderr);
+    vfprintf(stderr, fmt, args);
+  }
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,27 @@
+#!/usr/bin/env python3
+"""Writes the gzip-compressed web UI as C++ for the host build, like add_index_html() in __init__.py."""
+
+import importlib.util
+import sys
+from pathlib import Path
+
+COMPONENT = Path(__file__).resolve().parent.parent / "components" / "hydroponic_controller"
+
+
+def main():
+    spec = importlib.util.spec_from_file_location("index_html", COMPONENT / "index_html.py")
+    renderer = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(renderer)
+    # Хостовая сборка включает все блоки страницы
+    raw = renderer.render_index_html({flag: True for flag in renderer.index_flags()}).encode("utf-8")
+    data, etag = renderer.compress_index_html(raw)
+    Path(sys.argv[1]).write_text(
+        "#include <cstddef>\n#include <cstdint>\n"
+        f"extern const uint8_t HYDROPONIC_INDEX_HTML[{len(data)}] = {{{', '.join(str(b) for b in data)}}};\n"
+        f"extern const size_t HYDROPONIC_INDEX_HTML_SIZE = {len(data)};\n"
+        f'extern const char HYDROPONIC_INDEX_ETAG[] = "\\"{etag}\\"";\n',
+        encoding="utf-8")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,68 @@
+// Кольцо истории: после многих оборотов каждый ряд читается по порядку записи, без
+// пропусков, в том числе если читаемый блок вытесняют между вызовами copy_next().
+#include "check.h"
+
+#include "history_store.h"
+
+#include <cstdio>
+
+using namespace esphome::hydroponic_controller;
+
+static const uint8_t SERIES = 3;
+
+// Читает ряд целиком; метки должны идти подряд с шагом 1 и закончиться на last
+static uint32_t read_series(HistoryStore &store, uint8_t series, uint32_t last, uint32_t from = 0,
+                            uint32_t to = UINT32_MAX) {
+  HistoryStore::Cursor cursor;
+  HistoryBlock block;
+  uint32_t points = 0, prev = 0;
+  while (store.copy_next(series, &cursor, from, to, &block)) {
+    CHECK(block.h.series == series, "series %u got a block of series %u", series, block.h.series);
+    HistoryBlockReader reader(block);
+    uint32_t ts;
+    float v;
+    while (reader.next(&ts, &v)) {
+      CHECK(v == (float) (ts * 10 + series), "series %u: value %g at %u", series, v, ts);
+      CHECK(points == 0 || ts == prev + 1, "series %u: %u follows %u", series, ts, prev);
+      prev = ts;
+      points++;
+    }
+  }
+  CHECK(points > 0 && prev == last, "series %u: ends at %u, expected %u", series, prev, last);
+  return points;
+}
+
+int main() {
+  HistoryStore store;
+  CHECK(store.init(16 * sizeof(HistoryBlock)));
+
+  // Ряды пишутся с разной частотой, кольцо проходит много оборотов
+  uint32_t ts[SERIES] = {0, 0, 0};
+  for (uint32_t i = 0; i < 20000; i++) {
+    const uint8_t s = i % 7 == 0 ? 2 : i % 2;
+    ts[s]++;
+    store.append(s, ts[s], (float) (ts[s] * 10 + s));
+  }
+  uint32_t total = 0;
+  for (uint8_t s = 0; s < SERIES; s++) total += read_series(store, s, ts[s]);
+  printf("history: %u points in order after %u appends\n", total, 20000);
+
+  // Окно по времени отсекает старые блоки, но не рвёт порядок
+  read_series(store, 0, ts[0], ts[0] - 50, UINT32_MAX);
+
+  // Прочитанный блок вытеснен до следующего вызова: чтение продолжается с более новых
+  HistoryStore::Cursor cursor;
+  HistoryBlock block;
+  CHECK(store.copy_next(1, &cursor, 0, UINT32_MAX, &block));
+  const uint32_t seen = block.h.last_ts;
+  for (uint32_t i = 0; i < 2000; i++) {
+    ts[1]++;
+    store.append(1, ts[1], (float) (ts[1] * 10 + 1));
+  }
+  CHECK(store.copy_next(1, &cursor, 0, UINT32_MAX, &block));
+  CHECK(block.h.first_ts > seen, "evicted cursor went back to %u (had %u)", block.h.first_ts, seen);
+  read_series(store, 1, ts[1]);
+  for (uint8_t s = 0; s < SERIES; s += 2) read_series(store, s, ts[s]);
+  printf("history: reader resumed after its block was evicted\n");
+  return 0;
+}
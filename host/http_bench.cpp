@@ -0,0 +1,318 @@
+// Нагрузочный прогон настоящих Handler и HydroponicController на хосте: клиенты в
+// отдельных потоках шлют смесь /, /api/state и POST /api/batch в стенд-ин сервера,
+// запросы обрабатываются по одному, как задачей httpd, а loop() крутится в своём
+// потоке, как задача ESPHome. Выделения памяти считаются хуком malloc (alloc_count.cpp)
+// отдельно для обработки запроса и для итерации loop():
+//
+//   http_bench -c 1,2,4 -d 2 --save base.json
+//   http_bench -c 1,2,4 -d 2 --baseline base.json --max-regression 15
+#include "alloc_count.h"
+#include "check.h"
+#include "report.h"
+#include "sim.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::host;
+using Clock = std::chrono::steady_clock;
+
+enum RouteId { ROUTE_ID_INDEX, ROUTE_ID_STATE, ROUTE_ID_COMMAND, ROUTE_ID_COUNT };
+static const char *const ROUTE_NAMES[ROUTE_ID_COUNT] = {"index", "state", "command"};
+
+struct Options {
+  std::vector<int> levels{1, 2, 4};
+  double duration_s{2};
+  double weights[ROUTE_ID_COUNT]{1, 8, 1};
+  const char *save_path{nullptr};
+  const char *baseline_path{nullptr};
+  double max_regression{-1};
+};
+
+struct RouteStats {
+  std::vector<double> us;
+  uint64_t errors{0};
+  uint64_t allocs{0};
+  uint64_t bytes{0};
+};
+
+struct LevelResult {
+  double rps{0};
+  double p50_us{0}, p99_us{0}, p999_us{0};
+  uint64_t requests{0}, errors{0};
+  RouteStats routes[ROUTE_ID_COUNT];
+  double loop_p99_us{0}, loop_max_us{0}, loop_allocs{0};
+};
+
+static double percentile(std::vector<double> &v, double q) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t) (q * v.size()))];
+}
+
+static double elapsed_us(Clock::time_point since) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+}
+
+// Сервер: один запрос за раз, как в задаче httpd. Выделения считаются в потоке,
+// который обрабатывает запрос, поэтому сюда не попадают выделения loop()
+class Server {
+ public:
+  explicit Server(SimTower &tower) : tower_(tower) {}
+
+  Response handle(http_method method, const char *uri, const std::string &body, const char *accept_encoding,
+                  uint64_t *allocs) {
+    httpd_host_exchange ex;
+    if (!body.empty()) ex.headers.emplace_back("Content-Type", SimTower::FORM);
+    if (accept_encoding != nullptr) ex.headers.emplace_back("Accept-Encoding", accept_encoding);
+    ex.body = body;
+    std::lock_guard<std::mutex> guard(lock_);
+    const uint64_t before = allocations();
+    Response r = tower_.perform(method, uri, &ex);
+    *allocs = allocations() - before;
+    return r;
+  }
+
+ protected:
+  SimTower &tower_;
+  std::mutex lock_;
+};
+
+static LevelResult run_level(SimTower &tower, Server &server, const Options &opt, int clients,
+                             const std::string &command_body) {
+  std::atomic<bool> stop{false};
+  std::mutex merge_lock;
+  LevelResult result;
+
+  // loop() в реальном времени: виртуальные часы идут вместе с настоящими
+  std::vector<double> loop_us;
+  uint64_t loop_allocs = 0;
+  const uint64_t clock_base = now_us;
+  const auto started = Clock::now();
+  std::thread loop_thread([&] {
+    while (!stop) {
+      now_us = clock_base + (uint64_t) elapsed_us(started);
+      const uint64_t before = allocations();
+      const auto t0 = Clock::now();
+      tower.loop();
+      const double us = elapsed_us(t0);
+      loop_allocs += allocations() - before;
+      loop_us.push_back(us);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  std::vector<std::thread> threads;
+  for (int c = 0; c < clients; c++) {
+    threads.emplace_back([&, c] {
+      std::mt19937 rng(c);
+      std::discrete_distribution<int> pick(opt.weights, opt.weights + ROUTE_ID_COUNT);
+      RouteStats local[ROUTE_ID_COUNT];
+      while (!stop) {
+        const int route = pick(rng);
+        uint64_t allocs = 0;
+        const auto t0 = Clock::now();
+        Response r;
+        if (route == ROUTE_ID_INDEX) r = server.handle(HTTP_GET, "/", {}, "gzip", &allocs);
+        if (route == ROUTE_ID_STATE) r = server.handle(HTTP_GET, "/api/state", {}, nullptr, &allocs);
+        if (route == ROUTE_ID_COMMAND) r = server.handle(HTTP_POST, "/api/batch", command_body, nullptr, &allocs);
+        const double us = elapsed_us(t0);
+        auto &s = local[route];
+        if (r.status != 200) {
+          s.errors++;
+          continue;
+        }
+        s.us.push_back(us);
+        s.allocs += allocs;
+        s.bytes += r.body.size();
+      }
+      std::lock_guard<std::mutex> guard(merge_lock);
+      for (int i = 0; i < ROUTE_ID_COUNT; i++) {
+        auto &dst = result.routes[i];
+        dst.us.insert(dst.us.end(), local[i].us.begin(), local[i].us.end());
+        dst.errors += local[i].errors;
+        dst.allocs += local[i].allocs;
+        dst.bytes += local[i].bytes;
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(opt.duration_s));
+  stop = true;
+  for (auto &t : threads) t.join();
+  loop_thread.join();
+  const double seconds = elapsed_us(started) / 1e6;
+
+  std::vector<double> all;
+  for (auto &r : result.routes) {
+    all.insert(all.end(), r.us.begin(), r.us.end());
+    result.errors += r.errors;
+  }
+  result.requests = all.size();
+  result.rps = all.size() / seconds;
+  result.p50_us = percentile(all, 0.50);
+  result.p99_us = percentile(all, 0.99);
+  result.p999_us = percentile(all, 0.999);
+  result.loop_p99_us = percentile(loop_us, 0.99);
+  result.loop_max_us = loop_us.empty() ? 0 : *std::max_element(loop_us.begin(), loop_us.end());
+  result.loop_allocs = loop_us.empty() ? 0 : (double) loop_allocs / loop_us.size();
+  return result;
+}
+
+static double allocs_per_request(const RouteStats &r) { return r.us.empty() ? 0 : (double) r.allocs / r.us.size(); }
+
+// {"levels":{"<клиенты>":{...}}}, см. report.h
+static void save(const char *path, const std::map<int, LevelResult> &levels) {
+  FILE *f = fopen(path, "w");
+  CHECK(f != nullptr, "cannot write %s", path);
+  fprintf(f, "{\"levels\":{");
+  const char *sep = "";
+  for (const auto &kv : levels) {
+    const LevelResult &l = kv.second;
+    fprintf(f, "%s\n  \"%d\":{\"rps\":%.1f,\"p50_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"errors\":%llu,"
+               "\"loop_p99_us\":%.1f,\"loop_allocs\":%.3f",
+            sep, kv.first, l.rps, l.p50_us, l.p99_us, l.p999_us, (unsigned long long) l.errors, l.loop_p99_us,
+            l.loop_allocs);
+    for (int i = 0; i < ROUTE_ID_COUNT; i++)
+      fprintf(f, ",\"allocs_%s\":%.3f", ROUTE_NAMES[i], allocs_per_request(l.routes[i]));
+    fprintf(f, "}");
+    sep = ",";
+  }
+  fprintf(f, "\n}}\n");
+  fclose(f);
+}
+
+static void usage() {
+  fprintf(stderr, "usage: http_bench [-c 1,2,4] [-d SECONDS] [--mix index=1,state=8,command=1] [--quick]\n"
+                  "                  [--save FILE] [--baseline FILE] [--max-regression PCT]\n");
+  exit(2);
+}
+
+static void parse_mix(const char *text, Options *opt) {
+  std::fill(opt->weights, opt->weights + ROUTE_ID_COUNT, 0.0);
+  std::string mix(text);
+  size_t pos = 0;
+  while (pos <= mix.size()) {
+    const size_t end = std::min(mix.find(',', pos), mix.size());
+    const std::string part = mix.substr(pos, end - pos);
+    const size_t eq = part.find('=');
+    const std::string name = part.substr(0, eq);
+    int route = 0;
+    while (route < ROUTE_ID_COUNT && name != ROUTE_NAMES[route]) route++;
+    if (route == ROUTE_ID_COUNT) {
+      fprintf(stderr, "unknown route in --mix: %s (expected index, state, command)\n", name.c_str());
+      exit(2);
+    }
+    opt->weights[route] = eq == std::string::npos ? 1 : atof(part.c_str() + eq + 1);
+    pos = end + 1;
+  }
+}
+
+int main(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    const bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--quick") == 0) {
+      opt.levels = {1, 2};
+      opt.duration_s = 0.2;
+    } else if (strcmp(argv[i], "-c") == 0 && has_value) {
+      opt.levels.clear();
+      for (const char *p = argv[++i]; *p != '\0'; p += strspn(p, ",")) opt.levels.push_back(strtol(p, (char **) &p, 10));
+    } else if (strcmp(argv[i], "-d") == 0 && has_value) {
+      opt.duration_s = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--mix") == 0 && has_value) {
+      parse_mix(argv[++i], &opt);
+    } else if (strcmp(argv[i], "--save") == 0 && has_value) {
+      opt.save_path = argv[++i];
+    } else if (strcmp(argv[i], "--baseline") == 0 && has_value) {
+      opt.baseline_path = argv[++i];
+    } else if (strcmp(argv[i], "--max-regression") == 0 && has_value) {
+      opt.max_regression = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  reset();
+  SimTower tower(2, 2);
+  tower.clock.sync(1772323200);
+  tower.boot();
+  CHECK(tower.post("/api/pump-cycle?enabled=1&on=5&off=15").status == 200);
+  CHECK(tower.post("/api/light-schedule?enabled=1&on=1080&off=540").status == 200);
+  tower.run(6000);
+  Server server(tower);
+
+  // Как в tools/loadtest.py: текущее состояние помпы, выходы и настройки не меняются.
+  // Команда, которую отклоняет обработчик, мерила бы только ответ 400
+  char command_body[64];
+  snprintf(command_body, sizeof(command_body), "pump_on=%d&pump_speed=%d", (int) tower.pump(0).state,
+           tower.pump(0).speed);
+  uint64_t allocs;
+  const Response preflight = server.handle(HTTP_POST, "/api/batch", command_body, nullptr, &allocs);
+  CHECK(preflight.status == 200, "command preflight: %d %s", preflight.status, preflight.body.c_str());
+
+  const std::string baseline = opt.baseline_path != nullptr ? read_file(opt.baseline_path) : std::string();
+  std::map<int, LevelResult> levels;
+  std::vector<int> regressions;
+  bool failed = false;
+  printf("%4s %9s %8s %8s %8s %5s %9s %9s %8s %8s\n", "conc", "req/s", "p50 us", "p99 us", "p999 us", "err",
+         "loop p99", "loop max", "d req/s", "d p99");
+  for (const int level : opt.levels) {
+    LevelResult r = run_level(tower, server, opt, level, command_body);
+    printf("%4d %9.0f %8.1f %8.1f %8.1f %5llu %9.1f %9.1f", level, r.rps, r.p50_us, r.p99_us, r.p999_us,
+           (unsigned long long) r.errors, r.loop_p99_us, r.loop_max_us);
+    const std::string group = std::to_string(level);
+    double base_rps, base_p99;
+    if (r.errors != 0) {
+      // Ошибки меняют состав запросов: такой уровень с базовым не сравнивается
+      printf("  errors, not compared");
+      failed = true;
+    } else if (!baseline.empty() && report_value(baseline, group, "rps", &base_rps) &&
+               report_value(baseline, group, "p99_us", &base_p99)) {
+      const double d_rps = delta_pct(r.rps, base_rps), d_p99 = delta_pct(r.p99_us, base_p99);
+      printf(" %+7.1f%% %+6.1f%%", d_rps, d_p99);
+      bool regressed = d_p99 > opt.max_regression || -d_rps > opt.max_regression;
+      // Новое выделение памяти на запрос — регрессия при любом пороге
+      for (int i = 0; i < ROUTE_ID_COUNT; i++) {
+        double base_allocs;
+        const std::string field = std::string("allocs_") + ROUTE_NAMES[i];
+        if (report_value(baseline, group, field.c_str(), &base_allocs) &&
+            allocs_per_request(r.routes[i]) > base_allocs + 0.01)
+          regressed = true;
+      }
+      if (opt.max_regression >= 0 && regressed) regressions.push_back(level);
+    }
+    printf("\n");
+    for (int i = 0; i < ROUTE_ID_COUNT; i++) {
+      RouteStats &s = r.routes[i];
+      if (s.us.empty() && s.errors == 0) continue;
+      const size_t n = s.us.size();
+      const double allocs_per_req = allocs_per_request(s), bytes_per_req = n ? (double) s.bytes / n : 0;
+      const double p50 = percentile(s.us, 0.50), p99 = percentile(s.us, 0.99);
+      printf("     %-8s %8zu req %5llu err  p50 %7.1f us  p99 %7.1f us  %5.1f allocs/req  %6.0f B/req\n",
+             ROUTE_NAMES[i], n, (unsigned long long) s.errors, p50, p99, allocs_per_req, bytes_per_req);
+    }
+    printf("     loop     %.3f allocs/iteration\n", r.loop_allocs);
+    levels.emplace(level, std::move(r));
+  }
+  if (opt.save_path != nullptr) save(opt.save_path, levels);
+  if (failed) {
+    fprintf(stderr, "requests failed; see the err column\n");
+    return 1;
+  }
+  if (!regressions.empty()) {
+    fprintf(stderr, "regression over %.0f%% at concurrency", opt.max_regression);
+    for (int level : regressions) fprintf(stderr, " %d", level);
+    fprintf(stderr, "\n");
+    return 1;
+  }
+  return 0;
+}
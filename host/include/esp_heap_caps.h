@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+// Куча хостовой сборки не моделируется: постоянные значения держат метрики детерминированными
+inline size_t heap_caps_get_free_size(uint32_t caps) { return 200 * 1024; }
+inline size_t heap_caps_get_minimum_free_size(uint32_t caps) { return 200 * 1024; }
+inline size_t heap_caps_get_largest_free_block(uint32_t caps) { return 100 * 1024; }
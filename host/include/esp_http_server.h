@@ -0,0 +1,198 @@
+#pragma once
+
+// esp_http_server хостовой сборки: запрос и ответ живут в памяти (httpd_host_exchange),
+// сокеты сессий — строки в httpd_host_server. Поведение функций — как в ESP-IDF 5.
+#include <strings.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_HTTPD_BASE 0xb000
+#define ESP_ERR_HTTPD_RESULT_TRUNC (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_INVALID_REQ (ESP_ERR_HTTPD_BASE + 5)
+
+#define HTTPD_RESP_USE_STRLEN -1
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+#define HTTPD_MAX_URI_LEN 512
+// CONFIG_HTTPD_MAX_REQ_HDR_LEN; web_server_idf не принимает тело POST длиннее
+#define HTTPD_MAX_REQ_HDR_LEN 512
+
+enum http_method { HTTP_DELETE = 0, HTTP_GET = 1, HTTP_HEAD = 2, HTTP_POST = 3, HTTP_PUT = 4 };
+
+typedef void *httpd_handle_t;
+typedef void (*httpd_free_ctx_fn_t)(void *ctx);
+
+struct httpd_host_session {
+  void *ctx{nullptr};
+  httpd_free_ctx_fn_t free_ctx{nullptr};
+  std::string sent;  // всё, что отправлено в сокет после ответа на запрос
+  bool closed{false};
+};
+
+struct httpd_host_server {
+  std::map<int, httpd_host_session> sessions;
+  int next_fd{100};
+};
+
+// Один запрос: заголовки и тело запроса, накопленный ответ
+struct httpd_host_exchange {
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  size_t body_read{0};
+  int fd{-1};
+
+  std::string status{"200 OK"};
+  std::string type{"text/html"};
+  std::vector<std::pair<std::string, std::string>> resp_headers;
+  std::string resp_body;
+  bool sent{false};
+  bool chunked{false};
+
+  const char *header(const char *name) const {
+    for (auto &h : headers) {
+      if (strcasecmp(h.first.c_str(), name) == 0) return h.second.c_str();
+    }
+    return nullptr;
+  }
+};
+
+typedef struct httpd_req {
+  httpd_handle_t handle;
+  int method;
+  char uri[HTTPD_MAX_URI_LEN + 1];
+  size_t content_len;
+  void *aux;
+  void *user_ctx;
+  void *sess_ctx;
+  httpd_free_ctx_fn_t free_ctx;
+} httpd_req_t;
+
+inline httpd_host_exchange *httpd_host_ex(httpd_req_t *r) { return static_cast<httpd_host_exchange *>(r->aux); }
+
+inline esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status) {
+  httpd_host_ex(r)->status = status;
+  return ESP_OK;
+}
+
+inline esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type) {
+  httpd_host_ex(r)->type = type;
+  return ESP_OK;
+}
+
+inline esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value) {
+  httpd_host_ex(r)->resp_headers.emplace_back(field, value);
+  return ESP_OK;
+}
+
+inline esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t len) {
+  auto *ex = httpd_host_ex(r);
+  if (ex->sent) return ESP_ERR_HTTPD_INVALID_REQ;
+  if (buf != nullptr) ex->resp_body.append(buf, len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t) len);
+  ex->sent = true;
+  return ESP_OK;
+}
+
+// Пустой чанк завершает ответ
+inline esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t len) {
+  auto *ex = httpd_host_ex(r);
+  if (ex->sent) return ESP_ERR_HTTPD_INVALID_REQ;
+  ex->chunked = true;
+  if (buf == nullptr || len == 0) {
+    ex->sent = true;
+    return ESP_OK;
+  }
+  ex->resp_body.append(buf, len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t) len);
+  return ESP_OK;
+}
+
+inline size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field) {
+  const char *v = httpd_host_ex(r)->header(field);
+  return v != nullptr ? strlen(v) : 0;
+}
+
+inline esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size) {
+  const char *v = httpd_host_ex(r)->header(field);
+  if (v == nullptr) return ESP_ERR_NOT_FOUND;
+  if (val_size == 0) return ESP_ERR_INVALID_ARG;
+  const size_t n = strlen(v);
+  const size_t copy = n < val_size - 1 ? n : val_size - 1;
+  memcpy(val, v, copy);
+  val[copy] = '\0';
+  return n >= val_size ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+inline size_t httpd_req_get_url_query_len(httpd_req_t *r) {
+  const char *q = strchr(r->uri, '?');
+  return q != nullptr ? strlen(q + 1) : 0;
+}
+
+inline esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len) {
+  const char *q = strchr(r->uri, '?');
+  if (q == nullptr) return ESP_ERR_NOT_FOUND;
+  if (buf_len == 0) return ESP_ERR_INVALID_ARG;
+  const size_t n = strlen(q + 1);
+  const size_t copy = n < buf_len - 1 ? n : buf_len - 1;
+  memcpy(buf, q + 1, copy);
+  buf[copy] = '\0';
+  return n >= buf_len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+inline esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size) {
+  const size_t key_len = strlen(key);
+  for (const char *p = qry; p != nullptr && *p != '\0';) {
+    const char *end = strchr(p, '&');
+    const size_t len = end != nullptr ? (size_t) (end - p) : strlen(p);
+    if (len > key_len && p[key_len] == '=' && strncmp(p, key, key_len) == 0) {
+      const size_t n = len - key_len - 1;
+      if (val_size == 0) return ESP_ERR_INVALID_ARG;
+      const size_t copy = n < val_size - 1 ? n : val_size - 1;
+      memcpy(val, p + key_len + 1, copy);
+      val[copy] = '\0';
+      return n >= val_size ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+    }
+    p = end != nullptr ? end + 1 : nullptr;
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+// 0 — тело прочитано целиком
+inline int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len) {
+  auto *ex = httpd_host_ex(r);
+  const size_t left = ex->body.size() - ex->body_read;
+  const size_t n = left < buf_len ? left : buf_len;
+  memcpy(buf, ex->body.data() + ex->body_read, n);
+  ex->body_read += n;
+  return (int) n;
+}
+
+inline int httpd_req_to_sockfd(httpd_req_t *r) { return httpd_host_ex(r)->fd; }
+
+inline int httpd_socket_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags) {
+  auto &sessions = static_cast<httpd_host_server *>(hd)->sessions;
+  auto it = sessions.find(sockfd);
+  if (it == sessions.end() || it->second.closed) return HTTPD_SOCK_ERR_INVALID;
+  it->second.sent.append(buf, buf_len);
+  return (int) buf_len;
+}
+
+inline esp_err_t httpd_sess_trigger_close(httpd_handle_t hd, int sockfd) {
+  auto &sessions = static_cast<httpd_host_server *>(hd)->sessions;
+  auto it = sessions.find(sockfd);
+  if (it == sessions.end() || it->second.closed) return ESP_ERR_NOT_FOUND;
+  it->second.closed = true;
+  if (it->second.free_ctx != nullptr) it->second.free_ctx(it->second.ctx);
+  return ESP_OK;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "esphome/core/component.h"
+
+#include <functional>
+#include <vector>
+
+namespace esphome {
+namespace fan {
+
+class Fan;
+
+class FanTraits {
+ public:
+  explicit FanTraits(int speed_count = 100) : speed_count_(speed_count) {}
+  int supported_speed_count() const { return speed_count_; }
+
+ protected:
+  int speed_count_;
+};
+
+class FanCall {
+ public:
+  explicit FanCall(Fan &parent) : parent_(parent) {}
+  FanCall &set_state(bool state) {
+    state_ = state;
+    has_state_ = true;
+    return *this;
+  }
+  FanCall &set_speed(int speed) {
+    speed_ = speed;
+    has_speed_ = true;
+    return *this;
+  }
+  void perform();
+
+ protected:
+  Fan &parent_;
+  bool state_{false}, has_state_{false};
+  int speed_{0};
+  bool has_speed_{false};
+};
+
+// Вентилятор со скоростью 1..100, как speed fan на LEDC; без выходов — только состояние
+class Fan {
+ public:
+  bool state{false};
+  int speed{100};
+
+  FanTraits get_traits() { return FanTraits(100); }
+  FanCall turn_on() { return make_call().set_state(true); }
+  FanCall turn_off() { return make_call().set_state(false); }
+  FanCall make_call() { return FanCall(*this); }
+  void add_on_state_callback(std::function<void()> &&callback) { callbacks_.push_back(std::move(callback)); }
+
+  // Как Fan::publish_state(): колбэки на каждый perform()
+  void publish_state() {
+    for (auto &cb : callbacks_) cb();
+  }
+
+ protected:
+  std::vector<std::function<void()>> callbacks_;
+};
+
+inline void FanCall::perform() {
+  if (has_state_) parent_.state = state_;
+  if (has_speed_) {
+    const int max = parent_.get_traits().supported_speed_count();
+    parent_.speed = speed_ < 1 ? 1 : (speed_ > max ? max : speed_);
+  }
+  parent_.publish_state();
+}
+
+}  // namespace fan
+}  // namespace esphome
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "esphome/core/component.h"
+
+#include <functional>
+#include <vector>
+
+namespace esphome {
+namespace light {
+
+class LightState;
+
+class LightColorValues {
+ public:
+  bool is_on() const { return state_ != 0.0f; }
+  float get_state() const { return state_; }
+  float get_brightness() const { return brightness_; }
+  void set_state(float state) { state_ = state; }
+  void set_brightness(float brightness) { brightness_ = brightness < 0.0f ? 0.0f : (brightness > 1.0f ? 1.0f : brightness); }
+
+ protected:
+  float state_{0.0f};
+  float brightness_{1.0f};
+};
+
+class LightCall {
+ public:
+  explicit LightCall(LightState &parent) : parent_(parent) {}
+  LightCall &set_state(bool state) {
+    state_ = state;
+    has_state_ = true;
+    return *this;
+  }
+  LightCall &set_brightness(float brightness) {
+    brightness_ = brightness;
+    has_brightness_ = true;
+    return *this;
+  }
+  void perform();
+
+ protected:
+  LightState &parent_;
+  bool state_{false}, has_state_{false};
+  float brightness_{1.0f};
+  bool has_brightness_{false};
+};
+
+// Свет без переходов: новое значение сразу и в remote_values, и в current_values
+class LightState {
+ public:
+  LightColorValues current_values;
+  LightColorValues remote_values;
+
+  bool is_transformer_active() { return false; }
+  LightCall turn_on() { return make_call().set_state(true); }
+  LightCall turn_off() { return make_call().set_state(false); }
+  LightCall make_call() { return LightCall(*this); }
+  void add_new_remote_values_callback(std::function<void()> &&callback) {
+    callbacks_.push_back(std::move(callback));
+  }
+
+  void set_values(const LightColorValues &values) {
+    remote_values = values;
+    current_values = values;
+    for (auto &cb : callbacks_) cb();
+  }
+
+ protected:
+  std::vector<std::function<void()>> callbacks_;
+};
+
+inline void LightCall::perform() {
+  LightColorValues v = parent_.remote_values;
+  if (has_state_) v.set_state(state_ ? 1.0f : 0.0f);
+  if (has_brightness_) v.set_brightness(brightness_);
+  parent_.set_values(v);
+}
+
+}  // namespace light
+}  // namespace esphome
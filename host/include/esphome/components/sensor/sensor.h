@@ -0,0 +1,33 @@
+#pragma once
+
+#include "esphome/core/component.h"
+
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  explicit Sensor(std::string object_id = "sensor") : object_id_(std::move(object_id)) {}
+
+  float state{NAN};
+
+  std::string get_object_id() const { return object_id_; }
+  bool has_state() const { return !std::isnan(state); }
+  void publish_state(float value) {
+    state = value;
+    for (auto &cb : callbacks_) cb(value);
+  }
+  void add_on_state_callback(std::function<void(float)> &&callback) { callbacks_.push_back(std::move(callback)); }
+
+ protected:
+  std::string object_id_;
+  std::vector<std::function<void(float)>> callbacks_;
+};
+
+}  // namespace sensor
+}  // namespace esphome
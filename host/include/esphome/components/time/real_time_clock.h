@@ -0,0 +1,41 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/time.h"
+
+#include <functional>
+#include <vector>
+
+namespace esphome {
+namespace time {
+
+// Часы от виртуального времени: до sync() время невалидно, как до первой синхронизации SNTP
+class RealTimeClock {
+ public:
+  ESPTime now() { return ESPTime::from_epoch_local(epoch_()); }
+  ESPTime utcnow() {
+    ESPTime t = ESPTime::from_epoch_local(epoch_() - host::utc_offset_s);
+    t.timestamp = epoch_();
+    return t;
+  }
+  void add_on_time_sync_callback(std::function<void()> &&callback) { callbacks_.push_back(std::move(callback)); }
+
+  // Текущее виртуальное время становится моментом epoch
+  void sync(time_t epoch) {
+    base_epoch_ = epoch;
+    base_us_ = host::now_us;
+    synced_ = true;
+    for (auto &cb : callbacks_) cb();
+  }
+
+ protected:
+  time_t epoch_() const { return synced_ ? base_epoch_ + (time_t) ((host::now_us - base_us_) / 1000000) : 0; }
+
+  time_t base_epoch_{0};
+  uint64_t base_us_{0};
+  bool synced_{false};
+  std::vector<std::function<void()>> callbacks_;
+};
+
+}  // namespace time
+}  // namespace esphome
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace esphome {
+namespace web_server {
+
+class WebServer {};
+
+}  // namespace web_server
+}  // namespace esphome
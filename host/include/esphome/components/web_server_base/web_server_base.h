@@ -0,0 +1,70 @@
+#pragma once
+
+#include "esphome/components/web_server_idf/web_server_idf.h"
+
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace web_server_base {
+
+// Сервер хостовой сборки: обработчики вызываются в порядке добавления, как в
+// AsyncWebServer::request_handler_; тело POST-формы читается до обработчика, как в
+// request_post_handler. Сокеты сессий (SSE) — в get_server()->sessions.
+class WebServerBase {
+ public:
+  ~WebServerBase() {
+    for (auto *h : handlers_) delete h;
+  }
+
+  void add_handler(AsyncWebHandler *handler) { handlers_.push_back(handler); }
+
+  void handle(httpd_req_t *r) {
+    auto *ex = httpd_host_ex(r);
+    r->handle = &server_;
+    ex->fd = server_.next_fd++;
+    std::string post_query;
+    if (r->method == HTTP_POST) {
+      const char *type = ex->header("Content-Type");
+      if (type == nullptr || strcmp(type, "application/x-www-form-urlencoded") == 0) {
+        if (r->content_len > HTTPD_MAX_REQ_HDR_LEN) {
+          httpd_resp_set_status(r, "400 Bad Request");
+          httpd_resp_send(r, nullptr, 0);
+          return;
+        }
+        post_query.resize(r->content_len);
+        if (r->content_len > 0) post_query.resize(httpd_req_recv(r, &post_query[0], r->content_len));
+      }
+    }
+    AsyncWebServerRequest req(r, std::move(post_query));
+    bool handled = false;
+    for (auto *h : handlers_) {
+      if (h->canHandle(&req)) {
+        h->handleRequest(&req);
+        handled = true;
+        break;
+      }
+    }
+    if (!handled) {
+      httpd_resp_set_status(r, "404 Not Found");
+      httpd_resp_send(r, nullptr, 0);
+    }
+    // Контекст сессии (поток событий) живёт, пока сессию не закроют
+    if (r->sess_ctx != nullptr) {
+      auto &s = server_.sessions[ex->fd];
+      s.ctx = r->sess_ctx;
+      s.free_ctx = r->free_ctx;
+    }
+  }
+
+  httpd_host_server *get_server() { return &server_; }
+
+ protected:
+  std::vector<AsyncWebHandler *> handlers_;
+  httpd_host_server server_;
+};
+
+inline WebServerBase *global_web_server_base = nullptr;
+
+}  // namespace web_server_base
+}  // namespace esphome
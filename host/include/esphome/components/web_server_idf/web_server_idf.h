@@ -0,0 +1,119 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+
+#include <esp_http_server.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace esphome {
+namespace web_server_idf {
+
+class AsyncWebParameter {
+ public:
+  explicit AsyncWebParameter(std::string value) : value_(std::move(value)) {}
+  const std::string &value() const { return value_; }
+
+ protected:
+  std::string value_;
+};
+
+inline void url_decode(char *str) {
+  char *out = str;
+  for (; *str != '\0'; str++, out++) {
+    if (*str == '%' && isxdigit((unsigned char) str[1]) && isxdigit((unsigned char) str[2])) {
+      const char hex[3] = {str[1], str[2], '\0'};
+      *out = (char) strtol(hex, nullptr, 16);
+      str += 2;
+    } else {
+      *out = *str == '+' ? ' ' : *str;
+    }
+  }
+  *out = '\0';
+}
+
+// Как query_key_value() в web_server_idf: значение ключа, раскодированное из URL
+inline optional<std::string> query_key_value(const std::string &query, const std::string &key) {
+  std::unique_ptr<char[]> val(new char[query.size() + 1]);
+  if (httpd_query_key_value(query.c_str(), key.c_str(), val.get(), query.size() + 1) != ESP_OK) return {};
+  url_decode(val.get());
+  return std::string(val.get());
+}
+
+// Запрос с семантикой web_server_idf: тело формы уже прочитано сервером в post_query,
+// параметры ищутся сначала в нём, затем в query-строке и кэшируются
+class AsyncWebServerRequest {
+ public:
+  explicit AsyncWebServerRequest(httpd_req_t *req, std::string post_query = {})
+      : req_(req), post_query_(std::move(post_query)) {}
+  ~AsyncWebServerRequest() {
+    for (auto &p : params_) delete p.second;
+  }
+
+  http_method method() const { return static_cast<http_method>(req_->method); }
+  std::string url() const {
+    const char *q = strchr(req_->uri, '?');
+    return q == nullptr ? std::string(req_->uri) : std::string(req_->uri, q - req_->uri);
+  }
+  size_t contentLength() const { return req_->content_len; }
+
+  void send(int code, const char *content_type = nullptr, const char *content = nullptr) {
+    init_response_(code, content_type);
+    httpd_resp_send(req_, content, content != nullptr ? HTTPD_RESP_USE_STRLEN : 0);
+  }
+
+  bool hasParam(const std::string &name) { return getParam(name) != nullptr; }
+  AsyncWebParameter *getParam(const std::string &name) {
+    auto find = params_.find(name);
+    if (find != params_.end()) return find->second;
+    optional<std::string> val = query_key_value(post_query_, name);
+    if (!val.has_value()) {
+      const char *q = strchr(req_->uri, '?');
+      if (q != nullptr) val = query_key_value(q + 1, name);
+    }
+    AsyncWebParameter *param = val.has_value() ? new AsyncWebParameter(*val) : nullptr;
+    params_.insert({name, param});
+    return param;
+  }
+  bool hasArg(const char *name) { return hasParam(name); }
+  std::string arg(const std::string &name) {
+    auto *param = getParam(name);
+    return param != nullptr ? param->value() : std::string();
+  }
+
+  optional<std::string> get_header(const char *name) const {
+    const char *v = static_cast<httpd_host_exchange *>(req_->aux)->header(name);
+    if (v == nullptr) return {};
+    return std::string(v);
+  }
+
+  operator httpd_req_t *() const { return req_; }
+
+ protected:
+  void init_response_(int code, const char *content_type) {
+    httpd_resp_set_status(req_, code == 200 ? "200 OK" : code == 404 ? "404 Not Found" : std::to_string(code).c_str());
+    if (content_type != nullptr && *content_type != '\0') httpd_resp_set_type(req_, content_type);
+    httpd_resp_set_hdr(req_, "Accept-Ranges", "none");
+  }
+
+  httpd_req_t *req_;
+  std::string post_query_;
+  std::map<std::string, AsyncWebParameter *> params_;
+};
+
+class AsyncWebHandler {
+ public:
+  virtual ~AsyncWebHandler() = default;
+  virtual bool canHandle(AsyncWebServerRequest *request) const { return false; }
+  virtual void handleRequest(AsyncWebServerRequest *request) {}
+  virtual bool isRequestHandlerTrivial() const { return true; }
+};
+
+}  // namespace web_server_idf
+}  // namespace esphome
+
+using namespace esphome::web_server_idf;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+
+namespace setup_priority {
+inline const float HARDWARE = 800.0f;
+inline const float DATA = 600.0f;
+inline const float PROCESSOR = 400.0f;
+inline const float WIFI = 250.0f;
+inline const float AFTER_WIFI = 200.0f;
+inline const float LATE = -100.0f;
+}  // namespace setup_priority
+
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return setup_priority::DATA; }
+  virtual void on_shutdown() {}
+  virtual void on_safe_shutdown() {}
+  bool is_failed() const { return failed_; }
+
+ protected:
+  void mark_failed() { failed_ = true; }
+
+  bool failed_{false};
+};
+
+}  // namespace esphome
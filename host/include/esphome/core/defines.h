@@ -0,0 +1,3 @@
+#pragma once
+
+// Флаги USE_HYDRO_* задаются целями в host/CMakeLists.txt
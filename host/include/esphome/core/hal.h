@@ -0,0 +1,23 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace host {
+
+// Виртуальные часы хостовой сборки: время идёт только через advance(), поэтому
+// месяцы расписания проигрываются за секунды. millis() переполняется как на чипе.
+// Атомарные, потому что loop() и обработчики HTTP читают их из разных потоков.
+inline std::atomic<uint64_t> now_us{0};
+
+inline void advance_us(uint64_t us) { now_us += us; }
+inline void advance_ms(uint64_t ms) { now_us += ms * 1000; }
+
+}  // namespace host
+
+inline uint32_t millis() { return (uint32_t) (host::now_us / 1000); }
+inline uint32_t micros() { return (uint32_t) host::now_us; }
+inline void delay(uint32_t ms) { host::advance_ms(ms); }
+
+}  // namespace esphome
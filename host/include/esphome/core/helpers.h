@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace esphome {
+
+template<typename T> using optional = std::optional<T>;
+
+// Как в ESPHome: FNV-1, ключи настроек совпадают с прошивкой
+inline uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+class Mutex {
+ public:
+  void lock() { m_.lock(); }
+  bool try_lock() { return m_.try_lock(); }
+  void unlock() { m_.unlock(); }
+
+ private:
+  std::mutex m_;
+};
+
+class LockGuard {
+ public:
+  LockGuard(Mutex &m) : m_(m) { m_.lock(); }
+  ~LockGuard() { m_.unlock(); }
+
+ private:
+  Mutex &m_;
+};
+
+template<typename... Ts> class CallbackManager {
+ public:
+  void add(std::function<void(Ts...)> &&callback) { callbacks_.push_back(std::move(callback)); }
+  void call(Ts... args) {
+    for (auto &cb : callbacks_) cb(args...);
+  }
+
+ private:
+  std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+}  // namespace esphome
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace esphome {
+namespace host {
+
+// HYDRO_HOST_LOG=1 в окружении печатает журнал компонента в stderr
+inline int log_level = getenv("HYDRO_HOST_LOG") != nullptr ? atoi(getenv("HYDRO_HOST_LOG")) : 0;
+
+template<typename... Args> inline void log(char level, const char *tag, const char *fmt, Args... args) {
+  if (log_level == 0) return;
+  fprintf(stderr, "[%c][%s] ", level, tag);
+  if constexpr (sizeof...(Args) == 0) {
+    fputs(fmt, stderr);
+  } else {
+    fprintf(stderr, fmt, args...);
+  }
+  fputc('\n', stderr);
+}
+
+}  // namespace host
+}  // namespace esphome
+
+#define ESP_LOGE(tag, ...) ::esphome::host::log('E', tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::host::log('W', tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::host::log('I', tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::host::log('D', tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ::esphome::host::log('V', tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ::esphome::host::log('C', tag, __VA_ARGS__)
+#define PROGMEM
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+namespace host {
+
+// NVS хостовой сборки: save() кладёт данные в ожидание, sync() их фиксирует, как
+// ESP32Preferences. Счётчики и отказ записи нужны проверкам износа и ошибок.
+struct Flash {
+  std::map<uint32_t, std::vector<uint8_t>> committed;
+  std::map<uint32_t, std::vector<uint8_t>> pending;
+  uint32_t commits{0};
+  bool fail_sync{false};
+
+  void erase() {
+    committed.clear();
+    pending.clear();
+    commits = 0;
+  }
+};
+
+inline Flash flash;
+
+}  // namespace host
+
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() = default;
+  ESPPreferenceObject(uint32_t key, size_t size) : key_(key), size_(size) {}
+
+  template<typename T> bool save(const T *src) {
+    if (size_ != sizeof(T)) return false;
+    const auto *p = reinterpret_cast<const uint8_t *>(src);
+    host::flash.pending[key_].assign(p, p + sizeof(T));
+    return true;
+  }
+
+  template<typename T> bool load(T *dest) {
+    auto it = host::flash.committed.find(key_);
+    if (size_ != sizeof(T) || it == host::flash.committed.end() || it->second.size() != sizeof(T)) return false;
+    memcpy(dest, it->second.data(), sizeof(T));
+    return true;
+  }
+
+ protected:
+  uint32_t key_{0};
+  size_t size_{0};
+};
+
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t key, bool in_flash = false) {
+    return ESPPreferenceObject(key, sizeof(T));
+  }
+
+  bool sync() {
+    auto &flash = host::flash;
+    if (flash.fail_sync) {
+      flash.pending.clear();
+      return false;
+    }
+    for (auto &kv : flash.pending) flash.committed[kv.first] = std::move(kv.second);
+    if (!flash.pending.empty()) flash.commits++;
+    flash.pending.clear();
+    return true;
+  }
+};
+
+inline ESPPreferences preferences_instance;
+inline ESPPreferences *global_preferences = &preferences_instance;
+
+}  // namespace esphome
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+namespace esphome {
+
+namespace host {
+// Смещение местного времени от UTC для RealTimeClock::now(); часовой пояс хоста не влияет
+inline int32_t utc_offset_s = 0;
+}  // namespace host
+
+struct ESPTime {
+  uint8_t second;
+  uint8_t minute;
+  uint8_t hour;
+  uint8_t day_of_week;   // 1 — воскресенье
+  uint8_t day_of_month;  // 1..31
+  uint16_t day_of_year;  // 1..366
+  uint8_t month;         // 1..12
+  uint16_t year;
+  bool is_dst;
+  time_t timestamp;
+
+  // Как в ESPHome: время до 2019 года считается несинхронизированным
+  bool is_valid() const { return year >= 2019; }
+
+  static ESPTime from_epoch_local(time_t epoch) {
+    const time_t local = epoch + host::utc_offset_s;
+    struct tm t;
+    gmtime_r(&local, &t);
+    ESPTime r{};
+    r.second = t.tm_sec;
+    r.minute = t.tm_min;
+    r.hour = t.tm_hour;
+    r.day_of_week = t.tm_wday + 1;
+    r.day_of_month = t.tm_mday;
+    r.day_of_year = t.tm_yday + 1;
+    r.month = t.tm_mon + 1;
+    r.year = t.tm_year + 1900;
+    r.is_dst = false;
+    r.timestamp = epoch;
+    return r;
+  }
+};
+
+}  // namespace esphome
@@ -0,0 +1,42 @@
+#pragma once
+
+// Отчёты бенчмарков: плоский JSON {"<группа>":{"<поле>":число,...},...} внутри
+// корневого объекта; пишется при --save, читается при --baseline.
+#include "check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace esphome {
+namespace host {
+
+inline std::string read_file(const char *path) {
+  FILE *f = fopen(path, "r");
+  CHECK(f != nullptr, "cannot read %s", path);
+  std::string text;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+  fclose(f);
+  return text;
+}
+
+// Поле группы из отчёта; false — группы или поля в отчёте нет
+inline bool report_value(const std::string &text, const std::string &group, const char *field, double *out) {
+  const size_t start = text.find("\"" + group + "\":{");
+  if (start == std::string::npos) return false;
+  const size_t end = text.find('}', start);
+  const std::string key = std::string("\"") + field + "\":";
+  const size_t pos = text.find(key, start);
+  if (pos == std::string::npos || pos > end) return false;
+  *out = strtod(text.c_str() + pos + key.size(), nullptr);
+  return true;
+}
+
+// Изменение в процентах относительно базового значения
+inline double delta_pct(double value, double base) { return base > 0 ? (value / base - 1) * 100 : 0.0; }
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,217 @@
+// Проигрывание расписаний на виртуальных часах: месяцы работы помп и окон света,
+// включая окна через полночь и переполнение millis(), за секунды.
+#include "check.h"
+#include "sim.h"
+
+#include <chrono>
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::hydroponic_controller;
+
+static const time_t MARCH_1_2026 = 1772323200;  // 00:00:00 UTC
+static const uint64_t MINUTE_MS = 60000, HOUR_MS = 60 * MINUTE_MS, DAY_MS = 24 * HOUR_MS;
+
+static uint64_t now_ms() { return now_us / 1000; }
+
+// Окно [on, off) независимо от scheduler.h
+static bool in_window(int on, int off, int minute) {
+  if (on < off) return minute >= on && minute < off;
+  return minute >= on || minute < off;
+}
+
+static int local_minute(time::RealTimeClock &clock) {
+  const ESPTime t = clock.now();
+  return t.hour * 60 + t.minute;
+}
+
+// Переходы выхода: момент в мс виртуального времени и новое состояние
+struct Edges {
+  std::vector<std::pair<uint64_t, bool>> list;
+  bool last{false};
+
+  void note(bool state) {
+    if (state == last) return;
+    last = state;
+    list.emplace_back(now_ms(), state);
+  }
+};
+
+// Два канала помп 100 суток (millis() переполняется на 49.7 сутках). Фаза считается от
+// дедлайна, поэтому каждый переход опаздывает меньше чем на шаг loop() и ошибка не копится.
+static void pump_cycles() {
+  reset();
+  advance_ms(1234);  // старт не кратен шагу
+  SimTower t(2, 0);
+  t.controller.set_durations(5, 15);
+  Edges edges[2];
+  for (uint8_t ch = 0; ch < 2; ch++) t.pump(ch).add_on_state_callback([&, ch] { edges[ch].note(t.pump(ch).state); });
+  t.boot();
+  CHECK(t.post("/api/pump-cycle?enabled=1").status == 200);
+  const uint64_t start0 = now_ms();
+  advance_ms(500);
+  CHECK(t.post("/api/pump-cycle?ch=1&enabled=1&on=1&off=2").status == 200);
+  const uint64_t start1 = now_ms();
+
+  const uint32_t step = 1000;
+  const uint64_t duration = 100 * DAY_MS;
+  t.run(duration, step);
+  const uint64_t end = now_ms();
+
+  const uint64_t on_ms[2] = {5 * MINUTE_MS, 1 * MINUTE_MS}, off_ms[2] = {15 * MINUTE_MS, 2 * MINUTE_MS};
+  const uint64_t starts[2] = {start0, start1};
+  for (uint8_t ch = 0; ch < 2; ch++) {
+    const auto &list = edges[ch].list;
+    uint64_t expected = starts[ch];
+    size_t count = 0;
+    for (size_t i = 0; expected <= end; i++) {
+      const bool on = i % 2 == 0;
+      CHECK(i < list.size(), "pump %u: edge %zu missing at %llu ms", ch, i, (unsigned long long) expected);
+      CHECK(list[i].second == on, "pump %u: edge %zu has wrong direction", ch, i);
+      const int64_t late = (int64_t) (list[i].first - expected);
+      CHECK(late >= 0 && late < step, "pump %u: edge %zu late by %lld ms", ch, i, (long long) late);
+      expected += on ? on_ms[ch] : off_ms[ch];
+      count++;
+    }
+    CHECK(list.size() == count, "pump %u: %zu edges, expected %zu", ch, list.size(), count);
+    printf("pump %u: %zu edges over 100 days, none late by a full step\n", ch, count);
+  }
+}
+
+// Три окна света 90 суток с шагом 1 с: обычное, через полночь и короткое вокруг полуночи.
+// Граница окна попадает точно на начало минуты, поэтому состояние проверяется на каждом шаге.
+static void light_windows() {
+  reset();
+  utc_offset_s = 3 * 3600;
+  SimTower t(0, 3);
+  t.clock.sync(MARCH_1_2026);
+  t.boot();
+  const int windows[3][2] = {{1080, 540}, {360, 1320}, {1410, 30}};
+  for (uint8_t ch = 0; ch < 3; ch++) {
+    char uri[96];
+    snprintf(uri, sizeof(uri), "/api/light-schedule?ch=%u&enabled=1&on=%d&off=%d", ch, windows[ch][0],
+             windows[ch][1]);
+    CHECK(t.post(uri).status == 200);
+  }
+  Edges edges[3];
+  for (uint8_t ch = 0; ch < 3; ch++) {
+    t.light(ch).add_new_remote_values_callback([&, ch] { edges[ch].note(t.light(ch).current_values.is_on()); });
+  }
+  t.run(90 * DAY_MS, 1000, [&] {
+    const int minute = local_minute(t.clock);
+    for (uint8_t ch = 0; ch < 3; ch++) {
+      const bool expected = in_window(windows[ch][0], windows[ch][1], minute);
+      CHECK(t.light(ch).current_values.is_on() == expected, "light %u at %02d:%02d is %s", ch, minute / 60,
+            minute % 60, expected ? "off" : "on");
+    }
+  });
+  for (uint8_t ch = 0; ch < 3; ch++) {
+    // Первый переход — применение окна после настройки, дальше два в сутки
+    CHECK(edges[ch].list.size() >= 179 && edges[ch].list.size() <= 181, "light %u: %zu edges", ch,
+          edges[ch].list.size());
+    printf("light %u (%02d:%02d-%02d:%02d): %zu edges over 90 days, state matched every second\n", ch,
+           windows[ch][0] / 60, windows[ch][0] % 60, windows[ch][1] / 60, windows[ch][1] % 60,
+           edges[ch].list.size());
+  }
+  utc_offset_s = 0;
+}
+
+// Время синхронизируется после старта: до этого свет не трогается, после — окно сразу
+static void clock_sync_late() {
+  reset();
+  SimTower t(0, 1);
+  t.boot();
+  CHECK(t.post("/api/light-schedule?enabled=1&on=1080&off=540").status == 200);
+  t.run(10 * MINUTE_MS);
+  CHECK(!t.light(0).current_values.is_on());
+  t.clock.sync(MARCH_1_2026 + 20 * 3600);  // 20:00
+  t.run(1000);
+  CHECK(t.light(0).current_values.is_on());
+  t.run(13 * HOUR_MS);  // 09:00:01
+  CHECK(!t.light(0).current_values.is_on());
+  printf("light: window applied on the first loop after time sync\n");
+}
+
+// Ручное переключение держится до ближайшей границы окна
+static void manual_override() {
+  reset();
+  SimTower t(0, 1);
+  t.clock.sync(MARCH_1_2026 + 12 * 3600);  // 12:00
+  t.boot();
+  CHECK(t.post("/api/light-schedule?enabled=1&on=1080&off=540").status == 200);
+  t.run(1000);
+  CHECK(!t.light(0).current_values.is_on());
+  CHECK(t.post("/api/light?on=1").status == 200);
+  t.run(6 * HOUR_MS - 2000);  // 17:59:59
+  CHECK(t.light(0).current_values.is_on(), "manual ON outside the window must hold until 18:00");
+  CHECK(t.post("/api/light?on=0").status == 200);
+  t.run(2000);  // 18:00:01
+  CHECK(t.light(0).current_values.is_on(), "window start must switch the light on");
+  t.run(2 * HOUR_MS);
+  CHECK(t.post("/api/light?on=0").status == 200);
+  t.run(13 * HOUR_MS - 2000);  // 08:59:59
+  CHECK(!t.light(0).current_values.is_on(), "manual OFF inside the window must hold until 09:00");
+  t.run(9 * HOUR_MS + 2000);  // 18:00:01
+  CHECK(t.light(0).current_values.is_on());
+  printf("light: manual override held until the next window edge\n");
+}
+
+// Серия изменений — одна запись во флэш после паузы; после перезагрузки настройки на месте
+static void settings_persist() {
+  reset();
+  {
+    SimTower t(1, 1);
+    t.boot();
+    for (int i = 0; i < 20; i++) {
+      char uri[64];
+      snprintf(uri, sizeof(uri), "/api/pump-cycle?enabled=1&on=%d&off=9", 1 + i % 7);
+      CHECK(t.post(uri).status == 200);
+      t.run(100, 100);
+    }
+    CHECK(flash.commits == 0, "write before the debounce pause");
+    t.run(5000);
+    CHECK(flash.commits == 1, "%u flash commits for one burst", flash.commits);
+    CHECK(t.post("/api/light-schedule?enabled=1&on=1200&off=360").status == 200);
+    t.controller.on_shutdown();
+    CHECK(flash.commits == 2, "shutdown must flush pending settings");
+
+    // Непрерывные изменения записываются не позже MAX_DIRTY_MS
+    const uint32_t commits = flash.commits;
+    for (int i = 0; i < 90; i++) {
+      CHECK(t.post(i % 2 ? "/api/pump-cycle?off=10" : "/api/pump-cycle?off=11").status == 200);
+      t.run(1000);
+    }
+    CHECK(flash.commits > commits, "settings kept dirty for 90 s without a write");
+    t.controller.on_shutdown();
+  }
+  SimTower t(1, 1);
+  t.boot();
+  const std::string state = t.get("/api/state").body;
+  CHECK(state.find("\"pump_sched\":{\"enabled\":true,\"on\":6,\"off\":10}") != std::string::npos, "%s",
+        state.c_str());
+  CHECK(state.find("\"light_sched\":{\"enabled\":true,\"on\":1200,\"off\":360}") != std::string::npos, "%s",
+        state.c_str());
+  // Изменение, пришедшее во время flush(), не теряется: настройки остаются помеченными
+  SettingsStore<PackedSettings> store;
+  store.init(fnv1_hash("replay_settings"));
+  store.mark_dirty();
+  CHECK(store.flush([&](PackedSettings *s) {
+    encode_settings(ScheduleTable(), ScheduleTable(), s);
+    store.mark_dirty();
+  }));
+  CHECK(store.dirty(), "mark_dirty() during flush() was lost");
+  printf("settings: one write per burst, restored after reboot, no change lost during a flush\n");
+}
+
+int main() {
+  const auto start = std::chrono::steady_clock::now();
+  pump_cycles();
+  light_windows();
+  clock_sync_late();
+  manual_override();
+  settings_persist();
+  const auto ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  printf("schedule replay passed in %lld ms\n", (long long) ms);
+  return 0;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+// Башня на виртуальных часах: HydroponicController из компонента как есть, каналы —
+// стенд-ины fan/light, веб-сервер — web_server_base из host/include.
+#include "hydroponic_controller.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace host {
+
+using hydroponic_controller::HydroponicController;
+
+// Доступ к внутреннему состоянию для проверок и бенчмарков; поведение не меняется
+class TestController : public HydroponicController {
+ public:
+  using HydroponicController::flush_settings_;
+  using HydroponicController::snapshot_;
+  using HydroponicController::store_;
+};
+
+struct Response {
+  int status{0};
+  std::string type;
+  std::string body;
+  std::vector<std::pair<std::string, std::string>> headers;
+  bool chunked{false};
+
+  const char *header(const char *name) const {
+    for (auto &h : headers) {
+      if (strcasecmp(h.first.c_str(), name) == 0) return h.second.c_str();
+    }
+    return nullptr;
+  }
+};
+
+class SimTower {
+ public:
+  static constexpr const char *FORM = "application/x-www-form-urlencoded";
+
+  // Флэш (host::flash) переживает SimTower: новый экземпляр — это перезагрузка
+  SimTower(uint8_t pumps, uint8_t lights) {
+    web_ = std::make_unique<web_server_base::WebServerBase>();
+    web_server_base::global_web_server_base = web_.get();
+    for (uint8_t i = 0; i < pumps; i++) {
+      fans_.push_back(std::make_unique<fan::Fan>());
+      controller.add_pump(fans_.back().get());
+    }
+    for (uint8_t i = 0; i < lights; i++) {
+      lights_.push_back(std::make_unique<light::LightState>());
+      controller.add_light(lights_.back().get());
+    }
+    controller.set_clock(&clock);
+    controller.set_server(&server_);
+  }
+  ~SimTower() { web_server_base::global_web_server_base = nullptr; }
+
+  void boot() { controller.setup(); }
+  void loop() { controller.loop(); }
+
+  // step_ms шагов loop(); after — после каждого шага
+  template<typename F> void run(uint64_t duration_ms, uint32_t step_ms, F after) {
+    for (uint64_t t = 0; t < duration_ms; t += step_ms) {
+      advance_ms(step_ms);
+      controller.loop();
+      after();
+    }
+  }
+  void run(uint64_t duration_ms, uint32_t step_ms = 1000) {
+    run(duration_ms, step_ms, [] {});
+  }
+
+  Response request(http_method method, const std::string &uri, const std::string &body = {},
+                   const char *content_type = FORM) {
+    httpd_host_exchange ex;
+    if (!body.empty() && content_type != nullptr) ex.headers.emplace_back("Content-Type", content_type);
+    ex.body = body;
+    return perform(method, uri, &ex);
+  }
+
+  // Запрос с заранее заполненным обменом (заголовки, тело)
+  Response perform(http_method method, const std::string &uri, httpd_host_exchange *ex) {
+    httpd_req_t r{};
+    r.method = method;
+    snprintf(r.uri, sizeof(r.uri), "%s", uri.c_str());
+    r.content_len = ex->body.size();
+    r.aux = ex;
+    web_->handle(&r);
+    Response resp;
+    resp.status = atoi(ex->status.c_str());
+    resp.type = ex->type;
+    resp.body = std::move(ex->resp_body);
+    resp.headers = ex->resp_headers;
+    resp.chunked = ex->chunked;
+    return resp;
+  }
+
+  Response get(const std::string &uri) { return request(HTTP_GET, uri); }
+  Response post(const std::string &uri, const std::string &body = {}, const char *content_type = FORM) {
+    return request(HTTP_POST, uri, body, content_type);
+  }
+
+  fan::Fan &pump(uint8_t ch) { return *fans_[ch]; }
+  light::LightState &light(uint8_t ch) { return *lights_[ch]; }
+  web_server_base::WebServerBase &web() { return *web_; }
+
+  TestController controller;
+  time::RealTimeClock clock;
+
+ protected:
+  std::unique_ptr<web_server_base::WebServerBase> web_;
+  web_server::WebServer server_;
+  std::vector<std::unique_ptr<fan::Fan>> fans_;
+  std::vector<std::unique_ptr<light::LightState>> lights_;
+};
+
+// Начало с чистого листа: виртуальное время 0, пустая флэш
+inline void reset() {
+  now_us = 0;
+  flash.erase();
+}
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Render check for the hydroponic_controller web UI.
+
+Renders index.html the way the firmware build does (lines stripped and joined
+without newlines) for every combination of its `<!--if flag-->` blocks, then runs
+the inline script in node against a stub DOM and a stub `fetch`. A rendering
+passes when the script parses and its bootstrap loads `/api/state` and
+`/api/events`, so code that only breaks after joining (a `//` comment swallowing
+the rest of the script, a missing `;`) fails here instead of on the device:
+
+    tools/check_index_html.py
+    tools/check_index_html.py --node /usr/local/bin/node
+"""
+
+import argparse
+import importlib.util
+import itertools
+import json
+import re
+import subprocess
+import tempfile
+from pathlib import Path
+
+COMPONENT = Path(__file__).resolve().parent.parent / "components" / "hydroponic_controller"
+SCRIPT = re.compile(r"<script>(.*?)</script>", re.S)
+ELEMENT_ID = re.compile(r"id='(\w+)'")
+
+# Элементы с id доступны скрипту как глобальные переменные, как в браузере
+HARNESS = r"""
+const vm = require('vm'), fs = require('fs');
+const src = fs.readFileSync(process.argv[2], 'utf8'), ids = JSON.parse(process.argv[3]);
+const state = {pump_on: true, pump_speed: 60, light_on: false, light_brightness: 80,
+  pump_sched: {enabled: true, on: 5, off: 15}, light_sched: {enabled: true, on: 1080, off: 540}};
+const replies = {'/api/state': state, '/api/events': {events: [{seq: 1, t: 0, type: 'boot', ch: 0, value: 0}],
+  seq: 1, missed: 0, uptime: 10}};
+const fetched = [];
+const element = () => ({checked: false, value: '', textContent: '', style: {}, files: [], scrollTop: 0, scrollHeight: 0});
+const ctx = {console, Date, Math, JSON, Promise, Object, URLSearchParams, window: {},
+  setTimeout: () => 0, setInterval: () => 0,
+  fetch: url => {
+    fetched.push(url);
+    const body = replies[url.split('?')[0]];
+    return body ? Promise.resolve({ok: true, json: () => Promise.resolve(body)}) : Promise.reject(new Error(url));
+  }};
+const elements = {};
+for (const id of ids) ctx[id] = elements[id] = element();
+ctx.document = {getElementById: id => elements[id]};
+vm.createContext(ctx);
+vm.runInContext(src, ctx);
+process.on('beforeExit', () => {
+  const missing = ['/api/state', '/api/events?since=0'].filter(u => !fetched.includes(u));
+  if (missing.length || !elements.log.textContent.includes('Device started')) {
+    console.error('bootstrap incomplete: fetched ' + JSON.stringify(fetched) + '\n' + elements.log.textContent);
+    process.exit(1);
+  }
+});
+"""
+
+
+def load_renderer():
+    # index_html.py не зависит от ESPHome; __init__.py компонента импортировать нельзя
+    spec = importlib.util.spec_from_file_location("index_html", COMPONENT / "index_html.py")
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def run_script(node, html):
+    with tempfile.TemporaryDirectory() as tmp:
+        script = Path(tmp) / "index.js"
+        script.write_text("\n".join(SCRIPT.findall(html)), encoding="utf-8")
+        harness = Path(tmp) / "harness.js"
+        harness.write_text(HARNESS, encoding="utf-8")
+        ids = json.dumps(sorted(set(ELEMENT_ID.findall(html))))
+        return subprocess.run([node, str(harness), str(script), ids], capture_output=True, text=True, timeout=30)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--node", default="node", help="node executable")
+    args = parser.parse_args()
+
+    renderer = load_renderer()
+    flags = renderer.index_flags()
+    failures = 0
+    for values in itertools.product([True, False], repeat=len(flags)):
+        combo = dict(zip(flags, values))
+        label = ",".join(f"{k}={int(v)}" for k, v in combo.items())
+        try:
+            html = renderer.render_index_html(combo)
+        except ValueError as e:
+            print(f"FAIL [{label}] {e}")
+            failures += 1
+            continue
+        proc = run_script(args.node, html)
+        if proc.returncode != 0:
+            print(f"FAIL [{label}]\n{proc.stderr.strip()}")
+            failures += 1
+        else:
+            print(f"ok   [{label}] {len(html)} bytes")
+    if failures:
+        raise SystemExit(f"{failures} of {2 ** len(flags)} renderings failed")
+
+
+if __name__ == "__main__":
+    main()
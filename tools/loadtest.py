@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""HTTP load test for the hydroponic_controller API.
+
+Runs a weighted mix of `/`, `/api/state` and POST commands against a tower at each
+concurrency level for a fixed time, one keep-alive connection per client:
+
+    tools/loadtest.py 192.168.1.50 -c 1,2,4 -d 20 --save base.json
+    tools/loadtest.py 192.168.1.50 -c 1,2,4 -d 20 --baseline base.json --max-regression 15
+
+Reported per level:
+- client-side throughput and p50/p99/p999 latency, errors, bytes received and sent;
+- device-side handler latency and `loop()` time, from `/api/metrics` histograms read
+  before and after the level, with quantiles at bucket resolution;
+- the handler heap low-water mark.
+
+The firmware does not count allocations. A drop in the heap low-water mark under load
+is the closest available signal. host/http_bench runs the same mix against the real
+handler on Linux and counts allocations per request.
+
+The command is `POST /api/batch` with the pump's current `pump_on` and `pump_speed`, so
+outputs do not change and no settings are written. Each command still adds two events
+to `/api/events`. It is sent once before the first level and must return 200.
+
+A level with errors is not compared with the baseline and fails `--max-regression`.
+
+ESPHome's web server accepts a limited number of sockets (7 by default, shared with any
+open dashboards and event streams). Levels above that measure connection refusals
+rather than handler cost.
+"""
+
+import argparse
+import http.client
+import json
+import random
+import re
+import sys
+import threading
+import time
+from collections import defaultdict
+
+ROUTES = {
+    "index": ("GET", "/"),
+    "state": ("GET", "/api/state"),
+    "command": ("POST", "/api/batch"),
+}
+METRIC_LINE = re.compile(r'^(\w+)(?:\{([^}]*)\})? (\S+)$')
+LABEL = re.compile(r'(\w+)="([^"]*)"')
+
+
+def percentile(sorted_values, q):
+    if not sorted_values:
+        return 0.0
+    return sorted_values[min(len(sorted_values) - 1, int(q * len(sorted_values)))]
+
+
+def fetch(host, port, method, path, body=None, timeout=10):
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        headers = {"Content-Type": "application/x-www-form-urlencoded"} if body else {}
+        conn.request(method, path, body=body, headers=headers)
+        resp = conn.getresponse()
+        data = resp.read()
+        if resp.status != 200:
+            raise SystemExit(f"{method} {path}: HTTP {resp.status}")
+        return data
+    finally:
+        conn.close()
+
+
+def read_metrics(host, port):
+    """Prometheus text -> {(name, frozenset(labels)): value}."""
+    metrics = {}
+    for line in fetch(host, port, "GET", "/api/metrics").decode().splitlines():
+        m = METRIC_LINE.match(line)
+        if not m:
+            continue
+        labels = frozenset(LABEL.findall(m.group(2) or ""))
+        metrics[(m.group(1), labels)] = float(m.group(3))
+    return metrics
+
+
+def histogram_delta(before, after, name, route=None):
+    """Cumulative bucket counts added between two scrapes: [(le, count), ...]."""
+    buckets = []
+    for (metric, labels), value in after.items():
+        if metric != f"{name}_bucket":
+            continue
+        labels = dict(labels)
+        if route is not None and labels.get("route") != route:
+            continue
+        key = (metric, frozenset(labels.items()))
+        buckets.append((labels["le"], value - before.get(key, 0.0)))
+    buckets.sort(key=lambda b: float("inf") if b[0] == "+Inf" else float(b[0]))
+    return buckets
+
+
+def histogram_quantile(buckets, q):
+    """Upper bound of the bucket holding quantile q, in ms; None without samples."""
+    if not buckets or buckets[-1][1] <= 0:
+        return None
+    rank = q * buckets[-1][1]
+    for le, cumulative in buckets:
+        if cumulative >= rank:
+            return float("inf") if le == "+Inf" else float(le) * 1000
+    return None
+
+
+def run_level(args, concurrency, weights, command_body):
+    stop = time.monotonic() + args.duration
+    samples = defaultdict(list)
+    counters = defaultdict(int)
+    lock = threading.Lock()
+    names = list(weights)
+
+    def client(seed):
+        rng = random.Random(seed)
+        conn = None
+        local = defaultdict(list)
+        local_counters = defaultdict(int)
+        while time.monotonic() < stop:
+            name = rng.choices(names, weights=[weights[n] for n in names])[0]
+            method, path = ROUTES[name]
+            body = command_body if name == "command" else None
+            start = time.perf_counter()
+            try:
+                if conn is None:
+                    conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+                headers = {"Content-Type": "application/x-www-form-urlencoded"} if body else {}
+                if name == "index":
+                    headers["Accept-Encoding"] = "gzip"
+                conn.request(method, path, body=body, headers=headers)
+                resp = conn.getresponse()
+                data = resp.read()
+                elapsed = time.perf_counter() - start
+                if resp.status >= 400:
+                    local_counters["errors"] += 1
+                    local_counters["errors_" + name] += 1
+                    continue
+                local[name].append(elapsed)
+                local_counters["rx_bytes"] += len(data)
+                local_counters["tx_bytes"] += len(body or "")
+                if resp.getheader("Connection", "").lower() == "close":
+                    conn.close()
+                    conn = None
+            except (OSError, http.client.HTTPException):
+                local_counters["errors"] += 1
+                local_counters["errors_" + name] += 1
+                if conn is not None:
+                    conn.close()
+                conn = None
+                time.sleep(0.05)
+        if conn is not None:
+            conn.close()
+        with lock:
+            for name, values in local.items():
+                samples[name].extend(values)
+            for key, value in local_counters.items():
+                counters[key] += value
+
+    threads = [threading.Thread(target=client, args=(i,)) for i in range(concurrency)]
+    started = time.monotonic()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - started
+
+    all_ms = sorted(v * 1000 for values in samples.values() for v in values)
+    result = {
+        "requests": len(all_ms),
+        "rps": len(all_ms) / elapsed,
+        "p50_ms": percentile(all_ms, 0.50),
+        "p99_ms": percentile(all_ms, 0.99),
+        "p999_ms": percentile(all_ms, 0.999),
+        "errors": counters["errors"],
+        "rx_bytes": counters["rx_bytes"],
+        "tx_bytes": counters["tx_bytes"],
+        "routes": {},
+    }
+    for name in weights:
+        ms = sorted(v * 1000 for v in samples.get(name, []))
+        if not ms and not counters["errors_" + name]:
+            continue
+        result["routes"][name] = {"requests": len(ms), "errors": counters["errors_" + name],
+                                  "p50_ms": percentile(ms, 0.50), "p99_ms": percentile(ms, 0.99)}
+    return result
+
+
+def add_device_stats(result, before, after):
+    for name, (_, path) in ROUTES.items():
+        if name not in result["routes"]:
+            continue
+        buckets = histogram_delta(before, after, "hydro_http_request_duration_seconds", path)
+        result["routes"][name]["device_p99_ms"] = histogram_quantile(buckets, 0.99)
+    loop = histogram_delta(before, after, "hydro_loop_duration_seconds")
+    result["loop_p99_ms"] = histogram_quantile(loop, 0.99)
+    result["loop_p999_ms"] = histogram_quantile(loop, 0.999)
+    key = ("hydro_heap_handler_low_water_bytes", frozenset())
+    result["heap_low_water"] = after.get(key)
+    result["heap_low_water_drop"] = before.get(key, 0) - after.get(key, 0)
+
+
+def fmt_ms(value):
+    if value is None:
+        return "-"
+    return "inf" if value == float("inf") else f"{value:.2f}"
+
+
+def parse_mix(text):
+    weights = {}
+    for part in text.split(","):
+        name, _, weight = part.partition("=")
+        if name not in ROUTES:
+            raise SystemExit(f"unknown route in --mix: {name} (expected {', '.join(ROUTES)})")
+        weights[name] = float(weight or 1)
+    return {n: w for n, w in weights.items() if w > 0}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host", help="tower address")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("-c", "--concurrency", default="1,2,4", help="comma-separated client counts")
+    parser.add_argument("-d", "--duration", type=float, default=20, help="seconds per level")
+    parser.add_argument("--mix", default="index=1,state=8,command=1", help="route weights")
+    parser.add_argument("--timeout", type=float, default=10)
+    parser.add_argument("--save", metavar="FILE", help="write the report as JSON")
+    parser.add_argument("--baseline", metavar="FILE", help="JSON report to print deltas against")
+    parser.add_argument("--max-regression", type=float, metavar="PCT",
+                        help="exit with status 1 if p99 grows or throughput drops by more than PCT%% vs the baseline")
+    args = parser.parse_args()
+
+    weights = parse_mix(args.mix)
+    state = json.loads(fetch(args.host, args.port, "GET", "/api/state"))
+    command_body = f"pump_on={int(state['pump_on'])}&pump_speed={state['pump_speed']}"
+    if "command" in weights:
+        # Команда, которую отклоняет устройство, мерила бы только ответ 400
+        fetch(args.host, args.port, "POST", "/api/batch", body=command_body)
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline, encoding="utf-8") as f:
+            baseline = json.load(f).get("levels", {})
+
+    report = {"host": args.host, "mix": weights, "duration": args.duration, "levels": {}}
+    regressions = []
+    print(f"{'conc':>4} {'req/s':>8} {'p50 ms':>8} {'p99 ms':>8} {'p999 ms':>8} {'err':>5} {'rx KB':>8} "
+          f"{'loop p99':>9} {'heap lw':>8} {'d req/s':>8} {'d p99':>7}")
+    for level in (int(c) for c in args.concurrency.split(",")):
+        before = read_metrics(args.host, args.port)
+        result = run_level(args, level, weights, command_body)
+        after = read_metrics(args.host, args.port)
+        add_device_stats(result, before, after)
+        report["levels"][str(level)] = result
+
+        line = (f"{level:>4} {result['rps']:>8.1f} {fmt_ms(result['p50_ms']):>8} {fmt_ms(result['p99_ms']):>8} "
+                f"{fmt_ms(result['p999_ms']):>8} {result['errors']:>5} {result['rx_bytes'] / 1024:>8.1f} "
+                f"{fmt_ms(result['loop_p99_ms']):>9} {int(result['heap_low_water'] or 0):>8}")
+        base = baseline.get(str(level))
+        if result["errors"]:
+            # Ошибки меняют состав запросов: такой уровень с базовым не сравнивается
+            line += "  errors, not compared"
+            if args.max_regression is not None:
+                regressions.append(level)
+        elif base:
+            d_rps = (result["rps"] / base["rps"] - 1) * 100 if base["rps"] else 0.0
+            d_p99 = (result["p99_ms"] / base["p99_ms"] - 1) * 100 if base["p99_ms"] else 0.0
+            line += f" {d_rps:>+7.1f}% {d_p99:>+6.1f}%"
+            if args.max_regression is not None and (d_p99 > args.max_regression or -d_rps > args.max_regression):
+                regressions.append(level)
+        print(line)
+        for name, route in sorted(result["routes"].items()):
+            print(f"     {name:<8} {route['requests']:>7} req {route['errors']:>5} err  p50 {fmt_ms(route['p50_ms'])} ms  "
+                  f"p99 {fmt_ms(route['p99_ms'])} ms  handler p99 <= {fmt_ms(route.get('device_p99_ms'))} ms")
+
+    if args.save:
+        with open(args.save, "w", encoding="utf-8") as f:
+            json.dump(report, f, indent=2)
+    if regressions:
+        raise SystemExit(f"regression over {args.max_regression}% at concurrency {', '.join(map(str, regressions))}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Flash/RAM size report for hydroponic_controller configurations.
+
+Builds each YAML with `esphome compile` and collects the RAM/Flash summary that
+PlatformIO prints at the end of the build. Feature flags of the controller can be
+switched per run through substitutions, e.g. with `rest_api: ${rest_api}` in the YAML:
+
+    tools/size_report.py hydroponics_minimal.yaml hydroponics_pump_only.yaml
+    tools/size_report.py hydroponics.yaml -s web_ui=false -s ota_ui=false --save full.json
+    tools/size_report.py hydroponics_pump_only.yaml --baseline full.json
+
+Section-level numbers are available from the same build with
+`<toolchain>-size -A .esphome/build/<name>/.pioenvs/<name>/firmware.elf`.
+"""
+
+import argparse
+import json
+import re
+import subprocess
+import sys
+
+SIZE_LINE = re.compile(r"^(RAM|Flash):.*?\(used (\d+) bytes from (\d+) bytes\)", re.M)
+
+
+def build(yaml, substitutions):
+    cmd = ["esphome"]
+    for sub in substitutions:
+        key, _, value = sub.partition("=")
+        cmd += ["-s", key, value]
+    cmd += ["compile", yaml]
+    proc = subprocess.run(cmd, capture_output=True, text=True)
+    output = proc.stdout + proc.stderr
+    if proc.returncode != 0:
+        sys.stderr.write(output)
+        raise SystemExit(f"{yaml}: build failed")
+    sizes = {kind.lower(): {"used": int(used), "total": int(total)} for kind, used, total in SIZE_LINE.findall(output)}
+    if "ram" not in sizes or "flash" not in sizes:
+        raise SystemExit(f"{yaml}: no RAM/Flash summary in build output")
+    return sizes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("configs", nargs="+", help="ESPHome YAML files")
+    parser.add_argument("-s", "--substitution", action="append", default=[], metavar="KEY=VALUE",
+                        help="substitution passed to every build")
+    parser.add_argument("--save", metavar="FILE", help="write the report as JSON")
+    parser.add_argument("--baseline", metavar="FILE", help="JSON report to print deltas against")
+    args = parser.parse_args()
+
+    label = ",".join(args.substitution)
+    report = {}
+    for yaml in args.configs:
+        name = f"{yaml} [{label}]" if label else yaml
+        report[name] = build(yaml, args.substitution)
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline, encoding="utf-8") as f:
+            baseline = json.load(f)
+    # Без совпадающего имени сравнение идёт с первой записью базового отчёта
+    reference = next(iter(baseline.values()), None)
+
+    print(f"{'config':<48} {'flash':>10} {'ram':>8} {'d flash':>9} {'d ram':>7}")
+    for name, sizes in report.items():
+        base = baseline.get(name, reference)
+        line = f"{name:<48} {sizes['flash']['used']:>10} {sizes['ram']['used']:>8}"
+        if base is not None:
+            line += f" {sizes['flash']['used'] - base['flash']['used']:>+9} {sizes['ram']['used'] - base['ram']['used']:>+7}"
+        print(line)
+
+    if args.save:
+        with open(args.save, "w", encoding="utf-8") as f:
+            json.dump(report, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()